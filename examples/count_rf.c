@@ -25,16 +25,15 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    ccsv_row *row;
-
-    size_t fields_count = 0;
-    while ((row = ccsv_next(reader)) != NULL)
+    size_t rows_count = 0, fields_count = 0;
+    if (ccsv_count(reader, &rows_count, &fields_count) != CCSV_SUCCESS)
     {
-        fields_count += row->fields_count;
-        ccsv_free_row(row);
+        fprintf(stderr, "Error counting rows\n");
+        ccsv_close(reader);
+        return 1;
     }
 
-    printf("%s: %d rows, %ld fields\n", argv[1], reader->rows_read, fields_count);
+    printf("%s: %zu rows, %zu fields\n", argv[1], rows_count, fields_count);
 
     ccsv_close(reader);
 
@@ -33,11 +33,11 @@ int main(int argc, char **argv)
     ccsv_row *row;
     while ((row = ccsv_next(reader)) != NULL)
     {
-        ccsv_write(writer, *row);
+        ccsv_write_len(writer, *row);
         ccsv_free_row(row);
     }
 
-    printf("Rows read: %d\n", reader->rows_read);
+    printf("Rows read: %llu\n", (unsigned long long)reader->rows_read);
 
     printf("CSV file written to %s\n", destination);
 
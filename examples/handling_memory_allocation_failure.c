@@ -48,7 +48,7 @@ int main(void)
 
         ccsv_free_row(row);
     }
-    printf("\n\nRows read: %d\n", reader->rows_read);
+    printf("\n\nRows read: %llu\n", (unsigned long long)reader->rows_read);
 
     fclose(csv_file);
     free(reader);
@@ -33,7 +33,7 @@ int main(void)
         printf("\n");
         ccsv_free_row(row); // Free the memory allocated to the row
     }
-    printf("\n\nRows read: %d\n", reader->rows_read); // Print number of rows read
+    printf("\n\nRows read: %llu\n", (unsigned long long)reader->rows_read); // Print number of rows read
 
     ccsv_close(reader); // Close the reader
 
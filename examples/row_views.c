@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/ccsv.h"
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
+    return 1;
+  }
+
+  ccsv_reader *reader = ccsv_open(argv[1], CCSV_READER, "r", NULL, NULL);
+  if (reader == NULL)
+  {
+    fprintf(stderr, "Error initializing CSV reader\n");
+    return 1;
+  }
+
+  ccsv_row_view *row;
+  size_t bytes = 0;
+
+  // Fields of a view point into the reader buffer, nothing is allocated per row
+  while ((row = ccsv_next_view(reader)) != NULL)
+  {
+    for (int i = 0; i < row->fields_count; i++)
+    {
+      bytes += row->fields[i].len;
+    }
+  }
+
+  printf("%s: %llu rows, %zu bytes of field data\n", argv[1], (unsigned long long)reader->rows_read, bytes);
+
+  ccsv_close(reader);
+
+  return 0;
+}
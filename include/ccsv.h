@@ -38,6 +38,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define CCSV_VERSION 0.1f
 
@@ -58,6 +59,19 @@ extern "C"
 #define CCSV_BUFFER_SIZE 8096
 #define MAX_FIELD_SIZE 256
 
+#define CCSV_INDEX_WINDOW 65536 /* Bytes indexed per structural index pass */
+#define CCSV_ARENA_CHUNK_SIZE 65536 /* 64 KiB, grown for rows that do not fit */
+#ifndef CCSV_PARALLEL_CHUNK_SIZE
+#define CCSV_PARALLEL_CHUNK_SIZE 1048576 /* 1 MiB of the file per parallel parse task */
+#endif
+#define CCSV_ARROW_INITIAL_ROWS 1024 /* Rows a column builder is first allocated for */
+#define CCSV_DECODER_INPUT_SIZE 262144 /* 256 KiB of compressed bytes read at a time */
+#define CCSV_DECODER_READ_AHEAD 2 /* Buffers decompressed ahead when read_ahead is not set */
+#define CCSV_SNIFF_SIZE 65536 /* Bytes of the first buffer looked at by ccsv_sniff() */
+#define CCSV_SNIFF_HEADER_ROWS 20 /* Records compared with the first one to detect a header */
+#define CCSV_SNIFF_COLUMNS 64 /* Columns looked at to detect a header */
+#define CCSV_STATS_SAMPLE 16 /* With CCSV_STATS, one row in this many is timed */
+
 // Default values
 #define CCSV_DELIMITER 0x2c
 #define CCSV_QUOTE_CHAR 0x22
@@ -86,6 +100,12 @@ extern "C"
 #define CCSV_ERINVOBJTYPE -9  /* Invalid object type */
 #define CCSV_ERNULLROW -10    /* Row is NULL */
 #define CCSV_ERBUFNTALLOC -11 /* Buffer not allocated */
+#define CCSV_ERTIMEOUT -12    /* No new rows within follow_timeout */
+#define CCSV_ERAGAIN -13      /* Push reader has no complete row, feed more bytes */
+#define CCSV_ERRANGE -14      /* Value does not fit the type it is converted to */
+#define CCSV_ERFORMAT -15     /* Field is not a value of the type it is converted to */
+#define CCSV_ERDECODE -16     /* Compressed file is corrupt, or its format is not built in */
+#define CCSV_ERUTF8 -17       /* Invalid UTF-8 read with the validate_utf8 option */
 
 #define WRITE_SUCCESS CCSV_SUCCESS
 #define WRITE_STARTED 1
@@ -100,7 +120,8 @@ extern "C"
 #define CCSV_WRITER 22
 
 #define ARRAY_LEN(array) sizeof(array) / sizeof(array[0])
-#define IS_TERMINATOR(c) (c == CCSV_CR || c == CCSV_LF || c == CCSV_NULL_CHAR)
+#define IS_TERMINATOR(c) (c == CCSV_CR || c == CCSV_LF)
+#define IS_DIGIT(c) ((unsigned char)((c) - '0') < 10)
 
 // Writer Macros
 /* Start new row */
@@ -118,6 +139,18 @@ extern "C"
   }                                          \
   _write_field(fp, writer, string);
 
+/* Write field of known length, which may hold NUL bytes */
+#define CCSV_WRITE_FIELD_LEN(fp, writer, string, len) \
+  if (writer->__state == WRITER_ROW_START)            \
+  {                                                   \
+    writer->__state = WRITER_WRITING_FIELD;           \
+  }                                                   \
+  else                                                \
+  {                                                   \
+    fputc(writer->__delim, fp);                       \
+  }                                                   \
+  _write_field_len(fp, writer, string, len);
+
 /* End row, with an additional field */
 #define CCSV_WRITE_ROW_END(fp, writer, last_field) \
   if (last_field)                                  \
@@ -133,7 +166,9 @@ extern "C"
     FIELD_END,           /* End of field */
     FIELD_STARTED,       /* Inside field */
     INSIDE_QUOTED_FIELD, /* Inside quoted field */
-    MAY_BE_ESCAPED       /* Quote char detected inside quoted field */
+    MAY_BE_ESCAPED,      /* Quote char detected inside quoted field */
+    ESCAPED_CHAR,        /* Escape char detected inside quoted field */
+    INSIDE_COMMENT       /* Inside a comment line that is being skipped */
   } State;
 
   typedef enum WriterState
@@ -153,11 +188,101 @@ extern "C"
     int skip_initial_space;
     int skip_empty_lines;
     int skip_comments;
+    int use_arena; /* Allocate rows returned by ccsv_next() from a per-reader arena */
+    int use_mmap;  /* Parse regular files over a memory mapping instead of reading them */
+    int threads;   /* Parse a mapped file on this many threads, rows are still returned in order */
+    int read_ahead; /* Buffers filled by a background thread while the current one is parsed */
+    const int *usecols;         /* Columns to keep, rows hold only these fields in this order */
+    const char **usecols_names; /* Or the names of the columns to keep, looked up in the first record */
+    int usecols_count;
+    int follow;         /* Wait for rows appended to the file, checking every this many milliseconds */
+    int follow_timeout; /* Milliseconds to wait between rows before CCSV_ERTIMEOUT, 0 waits forever */
+    int has_header;     /* The first record holds the column names, it is not returned as a row */
+    int validate_utf8;  /* Fail on invalid UTF-8, skip a leading BOM and tell ASCII rows apart */
   } ccsv_reader_options;
 
+  typedef struct ccsv_arena_chunk
+  {
+    struct ccsv_arena_chunk *next;
+    size_t size;
+    size_t used;
+  } ccsv_arena_chunk;
+
+  typedef struct ccsv_arena
+  {
+    ccsv_arena_chunk *head;
+    ccsv_arena_chunk *current;
+    int live_rows; /* Rows allocated from the arena and not freed yet */
+  } ccsv_arena;
+
+  typedef struct ccsv_index
+  {
+    uint32_t *positions;     /* Offsets from base of delimiters and terminators outside quotes */
+    size_t count;            /* Number of positions */
+    size_t cursor;           /* Next position to be read */
+    size_t base;             /* Buffer offset of the indexed window */
+    size_t end;              /* Buffer offset indexed up to */
+    uint64_t in_quotes;      /* All ones if the indexed bytes end inside quotes */
+    uint64_t prev_boundary;  /* 1 if an opening quote may follow the last indexed byte */
+    uint64_t pending_close;  /* 1 if the last indexed byte is a closing quote */
+    uint32_t pending_escape; /* Set if an escaped quote follows the last position */
+    size_t irregular_end;    /* Records before this offset go through the state machine */
+    int backoff;             /* Buffer fills skipped after the last fallback */
+    int fallback_fills;      /* Buffer fills left to parse with the state machine */
+    bool stale;              /* Rebuild from the next record boundary */
+    bool enabled;
+  } ccsv_index;
+
+  typedef struct ccsv_field_view
+  {
+    const char *data; /* Points into the reader buffer, NUL terminated unless the file is mapped */
+    size_t len;
+  } ccsv_field_view;
+
+  typedef struct ccsv_row_view
+  {
+    ccsv_field_view *fields;
+    int fields_count;
+    bool ascii; /* No field has a byte above 0x7f, only set with validate_utf8 */
+  } ccsv_row_view;
+
+  /* Counters of a reader, only kept if ccsv is built with CCSV_STATS */
+  typedef struct ccsv_stats
+  {
+    uint64_t bytes_read;     /* Bytes read from the file after decompression, fed, or mapped */
+    uint64_t refills;        /* Reads into the buffer that returned bytes */
+    uint64_t rows;           /* Rows parsed for the caller, the header excluded */
+    uint64_t fields;         /* Fields in those rows */
+    uint64_t lines_skipped;  /* Empty and comment lines left out */
+    uint64_t buffer_grows;   /* Buffers holding field bytes grown for a longer record or field */
+    uint64_t fields_grows;   /* Arrays of fields grown for a wider record */
+    size_t max_field_length; /* Longest field in those rows */
+    int max_row_width;       /* Most fields in one of those rows */
+    uint64_t io_ns;          /* Nanoseconds spent reading or waiting for the file */
+    uint64_t parse_ns;       /* Nanoseconds spent parsing rows, reads excluded, from one row in CCSV_STATS_SAMPLE */
+  } ccsv_stats;
+
+  typedef struct ccsv_parse_state
+  {
+    State state;      /* State machine state inside the partial record */
+    size_t row_pos;   /* Buffer offsets of the partial record, it starts at __buffer_pos */
+    size_t field_start;
+    size_t field_pos;
+    int fields_count; /* Fields ended so far, their starts are in __field_starts */
+    char c;           /* Last byte read */
+    bool pending;     /* Set if a push reader ran out of bytes inside a record */
+  } ccsv_parse_state;
+
+  struct ccsv_parallel;
+  struct ccsv_read_ahead;
+  struct ccsv_row_index_header;
+  struct ccsv_arrow_column;
+  struct ccsv_header;
+  struct ccsv_decoder;
+
   typedef struct ccsv_reader
   {
-    int rows_read;
+    uint64_t rows_read; /* Rows returned so far, 64 bits for files of billions of rows */
     char __delim;
     char __quote_char;
     char __comment_char;
@@ -165,23 +290,173 @@ extern "C"
     int __skip_initial_space;
     int __skip_empty_lines;
     int __skip_comments;
+    int __use_arena;
+    int __use_mmap;
+    int __threads;
+    int __read_ahead_buffers;
+    int __follow;         /* Poll interval in milliseconds, 0 if reading stops at end of file */
+    int __follow_timeout;
+    int __follow_fd;      /* inotify descriptor watching the file, -1 if only polling */
+    bool __push;          /* Bytes are fed with ccsv_feed(), there is no file */
+    bool __seekable;      /* The file can be read again from an earlier offset, not a pipe */
+    bool __has_header;
+    bool __header_pending;       /* The next record is the header, it is read instead of returned */
+    struct ccsv_header *__header; /* Column names, NULL until the header is read */
+    int __validate_utf8;
+    bool __utf8_invalid;  /* Invalid bytes were read, reading stops */
+    bool __buffer_ascii;  /* No byte above 0x7f in the buffer */
+    size_t __utf8_checked; /* Buffer offset up to which bytes are validated */
+    size_t __bom_size;    /* BOM bytes skipped at the start of a mapped file, or held back by ccsv_feed() */
+    ccsv_parse_state __resume; /* Partial record of a push reader */
     char *__buffer;
-    size_t __buffer_pos;
-    size_t __buffer_size;
+    size_t __buffer_pos;      /* First unconsumed byte */
+    size_t __buffer_size;     /* Bytes of valid data in the buffer */
+    size_t __buffer_capacity; /* Bytes allocated for data, excluding the NUL sentinel */
     bool __buffer_allocated;
+    bool __eof;
+    bool __skip_lf; /* Last record ended with CR, swallow the LF of CRLF */
+    bool __mapped;  /* __buffer is a private mapping of the whole file */
+    bool __map_dirty; /* The state machine has written to the mapping */
+    size_t __map_size;
+    char *__scratch; /* Unescaped fields of a mapped file */
+    size_t __scratch_capacity;
     FILE *__fp;
     short status;
     short object_type;
     size_t __file_size;
     size_t __file_pos;
+    ccsv_field_view *__fields; /* Fields of the last parsed record */
+    size_t *__field_starts;    /* Buffer offsets of the fields, while parsing */
+    int __fields_capacity;
+    ccsv_row_view __row_view;
+    int *__usecols;               /* Column of each projected field */
+    int __usecols_count;          /* 0 if all columns are kept */
+    char **__usecols_names;       /* Names still to be looked up in the first record */
+    unsigned char *__column_used; /* Non-zero for projected columns, NULL if all are used */
+    int __column_used_count;
+    ccsv_field_view *__projected; /* Fields of the last record after projection */
+    uint64_t *__row_offsets;      /* Row index, where the reader stands before every __row_interval-th row */
+    size_t __row_offsets_count;
+    size_t __row_interval;
+    ccsv_arena __arena;
+    ccsv_index __index;
+    struct ccsv_parallel *__parallel; /* Worker threads of a parallel reader, NULL if serial */
+    struct ccsv_read_ahead *__read_ahead; /* Background reading thread, NULL if reading synchronously */
+    struct ccsv_decoder *__decoder;       /* Decompresses the file, NULL if it is read as is */
+    ccsv_stats __stats;
   } ccsv_reader;
 
   typedef struct ccsv_row
   {
     char **fields;
     int fields_count;
+    size_t *lengths; /* Length of each field, fields may hold NUL bytes */
+    bool ascii;      /* No field has a byte above 0x7f, only set with validate_utf8 */
+    ccsv_arena *__arena; /* Arena the row was allocated from, NULL if heap allocated */
+    int __fields_capacity; /* Field buffers kept by ccsv_next_into() */
+    size_t *__field_sizes; /* Allocated size of each field buffer */
   } ccsv_row;
 
+  typedef enum ccsv_type
+  {
+    CCSV_TYPE_STRING,    /* Any other text, or no value in the sample */
+    CCSV_TYPE_INT64,     /* Read with ccsv_to_int64() */
+    CCSV_TYPE_DOUBLE,    /* Read with ccsv_to_double() */
+    CCSV_TYPE_BOOL,      /* Read with ccsv_to_bool() */
+    CCSV_TYPE_DATE,      /* Read with ccsv_to_date() */
+    CCSV_TYPE_TIMESTAMP  /* Read with ccsv_to_timestamp() */
+  } ccsv_type;
+
+  typedef struct ccsv_column_info
+  {
+    ccsv_type type;
+    bool nullable;         /* Empty or missing in some sampled row */
+    size_t max_length;     /* Longest value in the sample */
+    unsigned __candidates; /* Types every value so far converts to, one bit per ccsv_type */
+  } ccsv_column_info;
+
+  typedef struct ccsv_schema
+  {
+    ccsv_column_info *columns;
+    int columns_count;
+    size_t rows_sampled;
+  } ccsv_schema;
+
+  typedef struct ccsv_batch
+  {
+    char *data;         /* Fields of all rows one after another, each NUL terminated */
+    size_t *offsets;    /* rows_count x columns, offset of each field in data */
+    size_t *lengths;    /* rows_count x columns, length of each field */
+    int *fields_counts; /* Fields of each row, the cells after them are empty */
+    int rows_count;
+    int columns;        /* Fields of the widest row */
+    size_t __data_size;
+    size_t __data_capacity;
+    size_t __cells_capacity;
+    int __rows_capacity;
+  } ccsv_batch;
+
+/*
+ * Arrow C Data Interface, as specified by Apache Arrow. Defined here so no
+ *   Arrow library is needed, the guard keeps it from clashing with other copies.
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+  struct ArrowSchema
+  {
+    // Array type description
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowSchema *);
+    // Opaque producer-specific data
+    void *private_data;
+  };
+
+  struct ArrowArray
+  {
+    // Array data description
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowArray *);
+    // Opaque producer-specific data
+    void *private_data;
+  };
+
+#endif // ARROW_C_DATA_INTERFACE
+
+  /* Position of a reader between two rows, plain data that can be saved and restored in a later run */
+  typedef struct ccsv_position
+  {
+    uint64_t rows_read; /* Rows read before the position */
+    uint64_t __offset;  /* File offset of the next record, with reader state in the high bit */
+  } ccsv_position;
+
+  /* Called by ccsv_parse() for each field, return non-zero to stop parsing */
+  typedef int (*ccsv_field_callback)(const char *field, size_t len, int column, void *user_data);
+
+  /* Called by ccsv_parse() after the last field of each row, return non-zero to stop parsing */
+  typedef int (*ccsv_row_callback)(size_t row, void *user_data);
+
   typedef struct ccsv_writer_options
   {
     char delim;
@@ -213,6 +488,19 @@ extern "C"
   void *ccsv_open(const char *filename, short object_type, const char *mode, void *options, short *status);
   void *ccsv_open_from_file(FILE *fp, short object_type, const char *mode, void *options, short *status);
 
+  /*
+   *  This function creates a reader that parses bytes passed to ccsv_feed()
+   *    instead of reading a file.
+   *
+   *  params:
+   *      options: reader options, NULL for default options
+   *      status: set to the error, may be NULL
+   *
+   *  returns:
+   *      ccsv_reader*: pointer to the reader, NULL if it cannot be created
+   */
+  ccsv_reader *ccsv_open_push(ccsv_reader_options *options, short *status);
+
   /*
    *  This function closes the ccsv object (reader or writer).
    *
@@ -270,14 +558,417 @@ extern "C"
    */
   ccsv_row *ccsv_next(ccsv_reader *reader);
 
+  /*
+   * This function reads a row from reader without copying its fields, and
+   *   returns a pointer to a row view owned by the reader.
+   *
+   *   Each field is a (data, len) span pointing into the reader buffer, quoted
+   *   fields are unescaped in place. The view and its spans are valid only
+   *   until the next call on the reader, copy anything that must outlive it.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *     ccsv_row_view*: pointer to the row view, NULL if all rows are read or on error
+   */
+  ccsv_row_view *ccsv_next_view(ccsv_reader *reader);
+
+  /*
+   * This function reads a row from reader into a caller owned CSVRow struct.
+   *
+   *   The fields array and field buffers of the row are reused across calls,
+   *   they are only grown when a row is wider or a field is longer than any
+   *   read into it before. Initialize the row with `ccsv_row row = {0};` and
+   *   release it with ccsv_clear_row().
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    row: pointer to the CSVRow struct to fill
+   *
+   * returns:
+   *    int: number of fields in the row
+   *    int: 0, if all rows are read
+   *    int: CCSV_ERNULLROW, if row is NULL
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int ccsv_next_into(ccsv_reader *reader, ccsv_row *row);
+
+  /*
+   *  This function frees the field buffers of a CSVRow struct filled by
+   *  ccsv_next_into(), the struct itself is not freed.
+   *
+   * params:
+   *    row: pointer to the CSVRow struct
+   */
+  void ccsv_clear_row(ccsv_row *row);
+
+  /*
+   * This function reads up to max_rows rows into batch, reusing its memory.
+   *
+   *   Field c of row r is batch->data + batch->offsets[r * batch->columns + c],
+   *   batch->lengths[r * batch->columns + c] bytes long. Rows shorter than
+   *   batch->columns are padded with empty fields.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    max_rows: maximum number of rows to read
+   *    batch: pointer to a zero initialized or reused ccsv_batch struct
+   *
+   * returns:
+   *    int: number of rows read, 0 if all rows are read
+   *    int: CCSV_ERINVALID, if batch is NULL or max_rows is not positive
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int ccsv_next_batch(ccsv_reader *reader, int max_rows, ccsv_batch *batch);
+
+  /*
+   *  This function frees the memory of a ccsv_batch struct filled by
+   *  ccsv_next_batch(), the struct itself is not freed.
+   *
+   * params:
+   *    batch: pointer to the ccsv_batch struct
+   */
+  void ccsv_clear_batch(ccsv_batch *batch);
+
+  /*
+   * This function reads up to max_rows rows into columns and exports them
+   *   through the Arrow C Data Interface, as a struct array with one utf8
+   *   child per column.
+   *
+   *   Columns use 32-bit offsets ("u"), or 64-bit offsets ("U") if their
+   *   data does not fit. Fields missing from rows shorter than the widest
+   *   row are null. With has_header, columns take their names from the
+   *   header, columns without one are named f0, f1, ... after their
+   *   position in the record. The caller owns array and schema and
+   *   releases them with their release callbacks.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    max_rows: maximum number of rows to read
+   *    array: set to the rows, untouched if no row is read
+   *    schema: set to the type of array, untouched if no row is read
+   *
+   * returns:
+   *    int: number of rows read, 0 if all rows are read
+   *    int: CCSV_ERINVALID, if array or schema is NULL or max_rows is not positive
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int ccsv_next_arrow(ccsv_reader *reader, int max_rows, struct ArrowArray *array, struct ArrowSchema *schema);
+
+  /*
+   * This function reads up to sample_rows rows to find the type of each
+   *   column, then puts the reader back where it was.
+   *
+   *   A column gets the first of int64, double, bool, date and timestamp
+   *   that all its values convert to, string otherwise. Empty fields and
+   *   fields missing from short rows are not values, they make the column
+   *   nullable.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    sample_rows: maximum number of rows to read
+   *    schema: pointer to a zero initialized or reused ccsv_schema struct
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERINVALID, if schema is NULL, sample_rows is 0 or the reader
+   *         cannot go back, a push reader or a pipe, nothing is read then
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int ccsv_infer_schema(ccsv_reader *reader, size_t sample_rows, ccsv_schema *schema);
+
+  /*
+   *  This function frees the columns of a ccsv_schema struct filled by
+   *  ccsv_infer_schema(), the struct itself is not freed.
+   *
+   * params:
+   *    schema: pointer to the ccsv_schema struct
+   */
+  void ccsv_clear_schema(ccsv_schema *schema);
+
+  /*
+   * This function looks up a column by its name in the header, the header
+   *   is read first if no row was read yet.
+   *
+   * params:
+   *    reader: pointer to a reader opened with the has_header option
+   *    name: name of the column
+   *
+   * returns:
+   *    int: index of the first column with that name, counted from 0
+   *    int: CCSV_ERINVALID, if there is no such column or no header
+   *    int: a negative status, if reading the header failed
+   */
+  int ccsv_column_index(ccsv_reader *reader, const char *name);
+
+  /*
+   * This function returns the name of a column in the header. Names are
+   *   interned, the same column always gives the same pointer.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    column: index of the column, counted from 0
+   *
+   * returns:
+   *    const char *: the name, valid until the reader is closed, or NULL if
+   *                  the header is not read yet or has no such column
+   */
+  const char *ccsv_column_name(ccsv_reader *reader, int column);
+
+  /*
+   * This function detects the dialect of a file from the first buffer of
+   *   its reader, and switches the reader to it. No more bytes are read than
+   *   the reader reads anyway, its rows are then parsed from the same buffer.
+   *
+   *   The delimiter is the one of ',', ';', '\t' and '|' that gives the most
+   *   consistent number of fields per record. The quote char is '"' unless
+   *   more fields start with '\'', and quotes escaped with a backslash
+   *   rather than doubled set escape_char to '\\'. The first record is a
+   *   header if its fields do not have the type or the length of the values
+   *   below them. LF, CRLF and CR line ends are all read by the reader and
+   *   are not part of the dialect.
+   *
+   * params:
+   *    reader: pointer to a reader that has not read any row yet
+   *    options: set to the detected dialect, can be used to open files like it
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERINVALID, if options is NULL or a row was already read
+   *    int: CCSV_ERAGAIN, if no bytes were fed to a push reader yet
+   *    int: other negative status, if reading the first buffer failed
+   */
+  int ccsv_sniff(ccsv_reader *reader, ccsv_reader_options *options);
+
+  /*
+   * This function counts the remaining rows of reader and their fields
+   *   without building any row, and leaves the reader at the end of the file.
+   *
+   *   Empty lines and comments are skipped as set in the reader options.
+   *   Fields are counted as they are in the file, usecols is not applied.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    rows: set to the number of rows, may be NULL
+   *    fields: set to the number of fields in all rows, may be NULL
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if all rows are counted
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int ccsv_count(ccsv_reader *reader, size_t *rows, size_t *fields);
+
+  /*
+   * This function copies the counters of a reader, kept since it was
+   *   opened. Seeking does not reset them.
+   *
+   *   Counters are only kept if ccsv is built with CCSV_STATS, otherwise
+   *   they cost nothing and are all 0. Reads are timed, parsing time is
+   *   estimated from one row in CCSV_STATS_SAMPLE.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    stats: set to the counters
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERINVALID, if stats is NULL
+   *    int: CCSV_ERROR, if ccsv is built without CCSV_STATS, stats is zeroed
+   */
+  int ccsv_reader_stats(ccsv_reader *reader, ccsv_stats *stats);
+
+  /*
+   * This function appends bytes to a push reader. Chunks may end anywhere,
+   *   inside a field or a record.
+   *
+   *   Rows are then read with ccsv_next(), ccsv_next_into() or
+   *   ccsv_next_view(), which stop with status CCSV_ERAGAIN when only a
+   *   partial record is left. A partial record is resumed where it stopped,
+   *   its bytes are not parsed again. Call with len 0 at the end of the
+   *   input, so a last record without a line end is returned as well.
+   *
+   * params:
+   *    reader: pointer to a reader from ccsv_open_push()
+   *    bytes: bytes to append, copied into the reader buffer
+   *    len: number of bytes, 0 to mark the end of the input
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   *    int: CCSV_ERINVALID, if the reader is not a push reader or the end
+   *         of the input is already marked
+   */
+  int ccsv_feed(ccsv_reader *reader, const char *bytes, size_t len);
+
+  /*
+   * This function parses the remaining rows of reader and passes their
+   *   fields to callbacks instead of returning rows. Nothing is allocated
+   *   per row.
+   *
+   *   Fields point into the reader buffer and are valid only during the
+   *   callback. They are NUL terminated unless the file is mapped. usecols
+   *   is applied, column is then the position in usecols. Rows are counted
+   *   from 0 as in reader->rows_read.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    on_field: called for each field, may be NULL
+   *    on_row_end: called after each row, may be NULL
+   *    user_data: passed to the callbacks
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if all rows are parsed
+   *    int: value returned by a callback that stopped the parse, the rest of
+   *         the current row is skipped
+   *    int: CCSV_ERAGAIN, if a push reader needs more bytes
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int ccsv_parse(ccsv_reader *reader, ccsv_field_callback on_field, ccsv_row_callback on_row_end, void *user_data);
+
+  /*
+   * This function builds a row index of the file of reader, saves it to
+   *   index_path and keeps it in the reader for ccsv_seek_row(). The reader
+   *   is moved back to the first row.
+   *
+   *   The index holds the file offset of every interval-th row, along with
+   *   the size and modification time of the file and the reader options
+   *   that decide what a row is.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    index_path: path of the index file to write
+   *    interval: rows between indexed offsets
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if the index is built and saved
+   *    int: CCSV_EROPEN, if the index file cannot be opened
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   *    int: CCSV_ERROR, if the index file cannot be written
+   */
+  int ccsv_build_row_index(ccsv_reader *reader, const char *index_path, size_t interval);
+
+  /*
+   * This function loads a row index saved by ccsv_build_row_index() into
+   *   reader.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    index_path: path of the index file
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if the index is loaded
+   *    int: CCSV_EROPEN, if the index file cannot be opened
+   *    int: CCSV_ERINVALID, if the index is not of this file, of this version
+   *         of it or of these reader options
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int ccsv_load_row_index(ccsv_reader *reader, const char *index_path);
+
+  /*
+   * This function moves reader to row number row, counted from 0, so the
+   *   next row read is that row. With a row index loaded the reader jumps to
+   *   the nearest indexed row and skips the rows after it, without one it
+   *   skips from the start of the file.
+   *
+   *   A parallel reader goes on serially after seeking past the first row.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    row: number of the row
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if the reader is at the row
+   *    int: CCSV_ERINVALID, if the file has fewer rows, the reader is then
+   *         at the end of the file
+   */
+  int ccsv_seek_row(ccsv_reader *reader, size_t row);
+
+  /*
+   * This function saves the position of reader, between the last row read
+   *   and the next one.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    position: pointer to the position to fill
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if the position is saved
+   *    int: CCSV_ERINVALID, if position is NULL
+   */
+  int ccsv_tell(ccsv_reader *reader, ccsv_position *position);
+
+  /*
+   * This function moves reader to a position saved by ccsv_tell(), on this
+   *   reader or on an earlier reader of the same file with the same options.
+   *   The next row read is the one that followed the position, and
+   *   reader->rows_read is restored.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    position: pointer to the saved position
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if the reader is at the position
+   *    int: CCSV_ERINVALID, if the position is past the end of the file
+   *    int: CCSV_ERROR, if the file cannot be seeked
+   */
+  int ccsv_seek(ccsv_reader *reader, const ccsv_position *position);
+
   /*
    *  This function frees the memory allocated to the CSVRow struct.
    *
+   *  Rows read with the use_arena option are released in constant time,
+   *  the arena is reset once every row allocated from it has been freed.
+   *
    * params:
    *    row: pointer to the CSVRow struct
    */
   void ccsv_free_row(ccsv_row *row);
 
+  /* -------- Conversion -------- */
+
+  /*
+   * These functions convert a field to a value. They take the field as a
+   *   span, so view fields can be converted without copying them. The whole
+   *   field must be the value, spaces around it are not skipped.
+   *
+   * params:
+   *    data: bytes of the field
+   *    len: number of bytes
+   *    value: set to the value if successful, untouched otherwise
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERFORMAT, if the field is not a value of the type
+   *    int: CCSV_ERRANGE, if the value does not fit the type, or a part of a
+   *         date or time is out of its range
+   *    int: CCSV_ERINVALID, if data or value is NULL
+   */
+
+  /* Decimal integer with an optional sign */
+  int ccsv_to_int64(const char *data, size_t len, int64_t *value);
+
+  /*
+   * Decimal number with an optional fraction and exponent, or inf, infinity
+   * or nan. The result is correctly rounded.
+   */
+  int ccsv_to_double(const char *data, size_t len, double *value);
+
+  /* true, t, yes, y, 1 or false, f, no, n, 0, in any case */
+  int ccsv_to_bool(const char *data, size_t len, bool *value);
+
+  /* ISO-8601 date YYYY-MM-DD, as days since 1970-01-01 */
+  int ccsv_to_date(const char *data, size_t len, int32_t *days);
+
+  /*
+   * ISO-8601 date, or date and time YYYY-MM-DDTHH:MM[:SS[.ffffff]], with
+   * T or a space between them and an optional Z, +HH:MM or -HH:MM offset.
+   * The result is in microseconds since 1970-01-01T00:00:00Z, times without
+   * an offset are taken as UTC and digits past microseconds are dropped.
+   */
+  int ccsv_to_timestamp(const char *data, size_t len, int64_t *microseconds);
+
   /* -------- Writer -------- */
 
   /*
@@ -298,6 +989,18 @@ extern "C"
    */
   int ccsv_write(ccsv_writer *writer, ccsv_row row);
 
+  /*
+   * This function writes a row (from CSVRow struct) to the file pointer,
+   * taking the length of each field from row.lengths instead of strlen, so
+   * fields may hold NUL bytes. row.lengths must match row.fields, it is not
+   * recomputed. Rows without lengths are written like ccsv_write().
+   *
+   * params:
+   *    writer: pointer to the writer
+   *    row: CSVRow struct, from the reader or with lengths filled in
+   */
+  int ccsv_write_len(ccsv_writer *writer, ccsv_row row);
+
   /*
    * This function writes a row (from string array) to the file pointer.
    *
@@ -321,6 +1024,17 @@ extern "C"
    */
   int write_row(FILE *fp, ccsv_writer *writer, ccsv_row row);
 
+  /*
+   *  This function writes a row (from CSVRow struct) to the file pointer,
+   *  using row.lengths if it is set.
+   *
+   * params:
+   *   fp: file pointer
+   *   writer: pointer to the writer
+   *   row: CSVRow struct
+   */
+  int write_row_len(FILE *fp, ccsv_writer *writer, ccsv_row row);
+
   /*
    *This function writes a row (from string array) to the file pointer.
    *
@@ -361,31 +1075,913 @@ extern "C"
   ccsv_row *_read_row(FILE *fp, ccsv_reader *reader);
 
   /*
-   * This function reads a row from the file pointer, and returns a pointer to CSVRow struct.
+   * This function reads a row from the reader, and returns a pointer to CSVRow struct.
+   *   The fields are copied out of the reader buffer.
    *
    * params:
-   *    fp: file pointer
    *    reader: pointer to the reader
    *
    * returns:
    *     CSVRow*: pointer to the CSVRow struct
    */
-  ccsv_row *_next(FILE *fp, ccsv_reader *reader);
-
-  /*
-   * This functions checks if the reader buffer is empty.
-   */
-  int _is_buffer_empty(ccsv_reader *reader);
+  ccsv_row *_next(ccsv_reader *reader);
 
   /*
-   *This function frees multiple pointers.
+   * This function copies the parsed record into a single block allocated from
+   *   the reader arena, and returns a pointer to CSVRow struct.
    *
    * params:
-   *      num: number of pointers to free
-   *      ...: pointers to free
+   *    reader: pointer to the reader
+   *    views: field spans of the parsed record
+   *    fields_count: number of fields in the record
    *
+   * returns:
+   *     CSVRow*: pointer to the CSVRow struct
    */
-  void _free_multiple(int num, ...);
+  ccsv_row *_next_from_arena(ccsv_reader *reader, const ccsv_field_view *views, int fields_count);
+
+  /*
+   * This function grows the fields array of a row filled by ccsv_next_into().
+   *
+   * params:
+   *    row: pointer to the CSVRow struct
+   *    min_capacity: minimum number of fields to make room for
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _grow_row(ccsv_row *row, int min_capacity);
+
+  /*
+   * This function makes room in a batch for another row of fields_count
+   *   fields and data_size bytes, and widens the rows already in it if
+   *   the row has more fields than batch->columns.
+   *
+   * params:
+   *    batch: pointer to the ccsv_batch struct
+   *    fields_count: number of fields of the row
+   *    data_size: bytes of the row fields, with their NUL terminators
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _grow_batch(ccsv_batch *batch, int fields_count, size_t data_size);
+
+  /*
+   * This function parses the next record in the reader buffer in place, and
+   *   stores its field spans in the reader row view.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: number of fields in the record
+   *    int: 0, if all rows are read
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _parse_row(ccsv_reader *reader);
+
+  /*
+   * This function parses the next record like _parse_row(), keeping all of
+   *   its fields.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: number of fields in the record
+   *    int: 0, if all rows are read
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _parse_record(ccsv_reader *reader);
+
+  /*
+   * This function moves the reader past a record found by
+   *   _index_next_record(), without unescaping its fields.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    fields_count: number of fields in the record
+   */
+  void _index_skip_record(ccsv_reader *reader, int fields_count);
+
+  /*
+   * This function moves the reader past the next record, without building
+   *   a row or projecting its fields.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: number of fields in the record
+   *    int: 0, if all rows are read
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _skip_record(ccsv_reader *reader);
+
+  /*
+   * This function returns the file offset of the next record, flagged with
+   *   CCSV_OFFSET_SKIP_LF if the LF of a CRLF ending the last record is still
+   *   to be skipped.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    uint64_t: the flagged offset
+   */
+  uint64_t _tell_offset(const ccsv_reader *reader);
+
+  /*
+   * This function moves the reader to an offset returned by _tell_offset(),
+   *   dropping buffered data.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    saved_offset: the flagged offset
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, or CCSV_ERROR if the file cannot be seeked
+   */
+  int _seek_offset(ccsv_reader *reader, uint64_t saved_offset);
+
+  /*
+   * This function reads the first record of the file to look up the usecols
+   *   names, or to read the header, before the reader is moved past it.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if all names are found
+   *    int: CCSV_ERINVALID, if a name is not found or the file is empty
+   */
+  int _resolve_usecols_at_start(ccsv_reader *reader);
+
+  /*
+   * This function fills the row index header expected for the file and
+   *   options of reader.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    header: pointer to the header to fill
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, or CCSV_ERROR if the file cannot be stat'ed
+   */
+  int _row_index_header(ccsv_reader *reader, struct ccsv_row_index_header *header);
+
+  /*
+   * This function makes room in an Arrow column builder for rows values
+   *   and data_size more bytes of data.
+   *
+   * params:
+   *    column: pointer to the column builder
+   *    rows: number of values to make room for
+   *    data_size: bytes to add to the data buffer
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _arrow_reserve(struct ccsv_arrow_column *column, int64_t rows, size_t data_size);
+
+  /*
+   * This function appends a field to an Arrow column builder.
+   *
+   * params:
+   *    column: pointer to the column builder
+   *    row: row of the field, the next one of the column
+   *    data: bytes of the field
+   *    len: number of bytes
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _arrow_add_field(struct ccsv_arrow_column *column, int64_t row, const char *data, size_t len);
+
+  /*
+   * This function appends a null to an Arrow column builder, creating its
+   *   validity bitmap on the first one.
+   *
+   * params:
+   *    column: pointer to the column builder
+   *    row: row of the null, the next one of the column
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _arrow_add_null(struct ccsv_arrow_column *column, int64_t row);
+
+  /*
+   * This function frees Arrow column builders that were not exported.
+   *
+   * params:
+   *    columns: array of column builders
+   *    columns_count: number of column builders
+   */
+  void _arrow_free_columns(struct ccsv_arrow_column *columns, int columns_count);
+
+  /*
+   * This function hands the buffers of the column builders over to an
+   *   Arrow struct array and builds its schema.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    columns: array of column builders
+   *    columns_count: number of column builders
+   *    rows: number of rows in the builders
+   *    array: set to the exported array
+   *    schema: set to the schema of array
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful, the builders no longer own their buffers
+   *    int: CCSV_ERNOMEM, if memory allocation failed, the builders are left as they were
+   */
+  int _arrow_export(ccsv_reader *reader, struct ccsv_arrow_column *columns, int columns_count, int64_t rows,
+                    struct ArrowArray *array, struct ArrowSchema *schema);
+
+  /*
+   * This function appends the decimal digits at data[pos] to value, eight
+   *   at a time where the platform allows.
+   *
+   * params:
+   *    data: bytes of the field
+   *    pos: position of the first digit
+   *    len: number of bytes in data
+   *    value: digits are appended to it
+   *    max_digits: maximum number of digits to read
+   *
+   * returns:
+   *    size_t: position after the last digit read
+   */
+  size_t _parse_digits(const char *data, size_t pos, size_t len, uint64_t *value, int max_digits);
+
+  /*
+   * This function converts a number that the fast path of ccsv_to_double()
+   *   cannot round exactly, with strtod().
+   *
+   * params:
+   *    data: bytes of a number already checked by ccsv_to_double()
+   *    len: number of bytes
+   *    value: set to the value if successful
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERRANGE, if the value overflows a double
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _parse_double_fallback(const char *data, size_t len, double *value);
+
+  /*
+   * This function compares a field to a lower case word, ignoring case.
+   *
+   * returns:
+   *    bool: true, if they are equal
+   */
+  bool _equals_ignore_case(const char *data, size_t len, const char *word);
+
+  /*
+   * This function converts the YYYY-MM-DD date at the start of a field.
+   *
+   * params:
+   *    data: bytes of the field
+   *    len: number of bytes
+   *    days: set to the days since 1970-01-01
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, CCSV_ERFORMAT or CCSV_ERRANGE as ccsv_to_date()
+   */
+  int _parse_date(const char *data, size_t len, int32_t *days);
+
+  /*
+   * This function counts the days from 1970-01-01 to a date of the
+   *   proleptic Gregorian calendar.
+   *
+   * returns:
+   *    int32_t: days since 1970-01-01, negative before it
+   */
+  int32_t _days_from_civil(int year, int month, int day);
+
+  /*
+   * This function narrows the candidate types of a column to those the
+   *   value converts to.
+   *
+   * params:
+   *    column: pointer to the column
+   *    data: bytes of the value
+   *    len: number of bytes, not 0
+   */
+  void _infer_value(ccsv_column_info *column, const char *data, size_t len);
+
+  /*
+   * This function sets up the column projection of the reader, copying the
+   *   column names if they are given instead of indices.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    usecols: indices of the columns to keep, or NULL
+   *    usecols_names: names of the columns to keep, or NULL
+   *    usecols_count: number of columns to keep
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if the projection is set up
+   *    int: CCSV_ERINVALID, if a column index is negative
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _init_usecols(ccsv_reader *reader, const int *usecols, const char **usecols_names, int usecols_count);
+
+  /*
+   * This function replaces the fields in the reader row view with the
+   *   projected columns, in the order they were given. Columns missing from
+   *   the record are empty.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    fields_count: number of fields in the record
+   *
+   * returns:
+   *    int: number of projected fields
+   *    int: CCSV_ERINVALID, if a column name is not in the first record
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _project_row(ccsv_reader *reader, int fields_count);
+
+  /*
+   * This function looks up the usecols names in the fields of the current
+   *   record.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if all names are found
+   *    int: CCSV_ERINVALID, if a name is not found
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _resolve_usecols(ccsv_reader *reader);
+
+  /*
+   * This function builds the table of projected columns, so unused quoted
+   *   fields are not unescaped.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, or CCSV_ERNOMEM if memory allocation failed
+   */
+  int _mark_used_columns(ccsv_reader *reader);
+
+  /*
+   * This function reads the header record into the column name table, and
+   *   looks up the usecols names in it. The record is not counted as a row.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: number of columns in the header, 0 if the file is empty
+   *    int: CCSV_ERINVALID, if a usecols name is not in the header
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   *    int: other negative status, if reading the record failed
+   */
+  int _read_header(ccsv_reader *reader);
+
+  /*
+   * This function copies the fields of the current record into the column
+   *   name table of the reader.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    fields_count: number of fields in the record
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, or CCSV_ERNOMEM if memory allocation failed
+   */
+  int _build_header(ccsv_reader *reader, int fields_count);
+
+  /*
+   * This function finds a name in the column name table.
+   *
+   * params:
+   *    header: pointer to the table
+   *    name: bytes of the name
+   *    len: number of bytes
+   *
+   * returns:
+   *    int: index of the first column with that name, or -1 if not found
+   */
+  int _header_lookup(const struct ccsv_header *header, const char *name, size_t len);
+
+  /*
+   * This function cuts one record of a dialect candidate into fields,
+   *   without unescaping them.
+   *
+   * params:
+   *    data: bytes sampled from the file
+   *    len: number of bytes
+   *    pos: offset of the record in data
+   *    at_end: data ends at the end of the file, a last record needs no line end
+   *    delim: delimiter of the candidate
+   *    quote: quote char of the candidate
+   *    escape: escape char of the candidate
+   *    fields: set to the spans of the first max_fields fields, quotes left out, may be NULL
+   *    max_fields: number of spans fields has room for
+   *    fields_count: set to the number of fields in the record
+   *
+   * returns:
+   *    size_t: offset of the next record, 0 if the record is cut by the end of data
+   */
+  size_t _sniff_record(const char *data, size_t len, size_t pos, bool at_end, char delim, char quote, char escape,
+                       ccsv_field_view *fields, int max_fields, int *fields_count);
+
+  /*
+   * This function finds the quote char of a sample from the quotes at field
+   *   boundaries, and how quotes inside quoted fields are escaped.
+   *
+   * params:
+   *    data: bytes sampled from the file
+   *    len: number of bytes
+   *    quote: set to the quote char
+   *    escape: set to the escape char, the quote char if quotes are doubled
+   */
+  void _sniff_quoting(const char *data, size_t len, char *quote, char *escape);
+
+  /*
+   * This function scores a delimiter by how consistent the number of fields
+   *   per record is, empty lines are left out.
+   *
+   * params:
+   *    data: bytes sampled from the file
+   *    len: number of bytes
+   *    at_end: data ends at the end of the file
+   *    delim: delimiter to score
+   *    quote: quote char of the sample
+   *    escape: escape char of the sample
+   *
+   * returns:
+   *    double: score, higher is better, 0 if no record has the delimiter
+   */
+  double _sniff_score(const char *data, size_t len, bool at_end, char delim, char quote, char escape);
+
+  /*
+   * This function tells whether the first record of a sample is a header,
+   *   by comparing each of its fields with the values below them.
+   *
+   * params:
+   *    data: bytes sampled from the file
+   *    len: number of bytes
+   *    at_end: data ends at the end of the file
+   *    delim: delimiter of the sample
+   *    quote: quote char of the sample
+   *    escape: escape char of the sample
+   *
+   * returns:
+   *    bool: true if the first record looks like a header
+   */
+  bool _sniff_header(const char *data, size_t len, bool at_end, char delim, char quote, char escape);
+
+  /*
+   * This function parses the next record with the structural index, and
+   *   stores its field spans in the reader row view.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: number of fields in the record
+   *    int: 0, if all rows are read
+   *    int: CCSV_INDEX_FALLBACK, if the record must be parsed by _parse_record()
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _parse_row_indexed(ccsv_reader *reader);
+
+  /*
+   * This function finds the next record with the structural index without
+   *   touching its bytes. The offset of the byte ending each field is stored
+   *   in reader->__field_starts, flagged with CCSV_FIELD_ESCAPED if the field
+   *   holds escaped quotes. The record is consumed only by the caller.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    row_start: set to the offset of the first byte of the record
+   *
+   * returns:
+   *    int: number of fields in the record
+   *    int: 0, if all rows are read
+   *    int: CCSV_INDEX_FALLBACK, if the record must be parsed by _parse_record()
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _index_next_record(ccsv_reader *reader, size_t *row_start);
+
+  /*
+   * This function cuts the fields of a record found by _index_next_record(),
+   *   stores their spans in the reader row view and consumes the record.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    row_start: offset of the first byte of the record
+   *    fields_count: number of fields in the record
+   *
+   * returns:
+   *    int: number of fields in the record
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _index_emit_record(ccsv_reader *reader, size_t row_start, int fields_count);
+
+  /*
+   * This function builds the structural index for the next window of the
+   *   reader buffer, carrying the quote state over from the previous window.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_INDEX_FALLBACK, if quotes in the window are not at field boundaries
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _index_build(ccsv_reader *reader);
+
+  /*
+   * This function resets the structural index to start at a record boundary.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    from: buffer offset of the record
+   */
+  void _index_reset(ccsv_reader *reader, size_t from);
+
+  /*
+   * This function validates the bytes added to the reader buffer since the
+   *   last call. A sequence cut by the end of the buffer is validated with
+   *   the next bytes, unless final is set.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    final: no more bytes follow
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if the bytes are valid UTF-8
+   *    int: CCSV_ERUTF8, if they are not, reading stops
+   */
+  int _utf8_check_buffer(ccsv_reader *reader, bool final);
+
+  /*
+   * This function validates a mapped file as a whole and skips its BOM. An
+   *   invalid file is unmapped, so it is read through the buffer and fails
+   *   once the invalid bytes are read.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if the file is valid UTF-8
+   *    int: CCSV_ERUTF8, if it is not and was unmapped
+   */
+  int _utf8_check_mapping(ccsv_reader *reader);
+
+  /*
+   * This function appends fed bytes to the buffer of a push reader.
+   *
+   * params:
+   *    reader: pointer to the push reader
+   *    bytes: bytes to append
+   *    len: number of bytes
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   *    int: CCSV_ERUTF8, if validate_utf8 is set and the bytes are invalid
+   */
+  int _feed_bytes(ccsv_reader *reader, const char *bytes, size_t len);
+
+  /*
+   * This function maps a regular file in place of the reader buffer, so the
+   *   whole file is parsed without reading it into the buffer.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    fp: file pointer of the file to map
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERROR, if the file cannot be mapped, it is read through the buffer then
+   */
+  int _map_file(ccsv_reader *reader, FILE *fp);
+
+  /*
+   * This function moves the unconsumed bytes starting at keep_from to the
+   *   front of the reader buffer and fills the rest of it from the file.
+   *   The buffer is grown if keep_from is 0 and the buffer is full.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    keep_from: offset of the first byte to keep
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   *    int: CCSV_ERUTF8, if validate_utf8 is set and the bytes are invalid
+   *    int: CCSV_ERDECODE, if the compressed input is corrupt
+   */
+  int _fill_buffer(ccsv_reader *reader, size_t keep_from);
+
+  /*
+   * This function marks the structural index stale after the buffer
+   *   contents have moved or changed.
+   *
+   * params:
+   *    reader: pointer to the reader
+   */
+  void _index_invalidate(ccsv_reader *reader);
+
+  /*
+   * This function grows the field span arrays of the reader.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    min_capacity: minimum number of fields to make room for
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _grow_fields(ccsv_reader *reader, int min_capacity);
+
+  /*
+   * This function grows the scratch buffer holding unescaped fields of a
+   *   mapped file.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    min_capacity: minimum number of bytes to make room for
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _grow_scratch(ccsv_reader *reader, size_t min_capacity);
+
+  /*
+   * This function starts the worker threads of a reader over a mapped file.
+   *   The file is split in CCSV_PARALLEL_CHUNK_SIZE byte chunks, which are
+   *   parsed ahead of the caller and handed out in file order.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    threads: number of worker threads
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERROR, if threads are not available, the reader stays serial then
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _parallel_start(ccsv_reader *reader, int threads);
+
+  /*
+   * This function starts a thread that reads the file into a ring of
+   *   buffers ahead of the parser.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    buffers: number of buffers to read ahead
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if successful
+   *    int: CCSV_ERROR, if threads are not available, the reader reads synchronously then
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _read_ahead_start(ccsv_reader *reader, int buffers);
+
+  /*
+   * This function stops the read-ahead thread and frees its buffers.
+   *
+   * params:
+   *    reader: pointer to the reader
+   */
+  void _read_ahead_stop(ccsv_reader *reader);
+
+  /*
+   * This function copies bytes read ahead into dst. It waits for the
+   *   reading thread only if no bytes are ready.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    dst: where to copy the bytes
+   *    size: maximum number of bytes to copy
+   *
+   * returns:
+   *    size_t: number of bytes copied, 0 at the end of the file
+   */
+  size_t _read_ahead(ccsv_reader *reader, char *dst, size_t size);
+
+  /*
+   * This function reads bytes of the file, through the decoder if the file
+   *   is compressed.
+   *
+   * params:
+   *    fp: file pointer
+   *    decoder: pointer to the decoder, or NULL
+   *    dst: where to copy the bytes
+   *    size: maximum number of bytes to copy
+   *
+   * returns:
+   *    size_t: number of bytes copied, 0 at the end of the file or on error
+   */
+  size_t _read_source(FILE *fp, struct ccsv_decoder *decoder, char *dst, size_t size);
+
+  /*
+   * This function looks at the first bytes of the file, and sets up a
+   *   decoder on the reader if they are the magic bytes of a gzip or zstd
+   *   file.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    fp: file pointer, at the start of the file
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, also if the file is not compressed
+   *    int: CCSV_ERDECODE, if the format is not built in
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _decoder_open(ccsv_reader *reader, FILE *fp);
+
+  /*
+   * This function decompresses bytes into dst.
+   *
+   * params:
+   *    decoder: pointer to the decoder
+   *    dst: where to write the bytes
+   *    size: maximum number of bytes to write
+   *
+   * returns:
+   *    size_t: number of bytes written, 0 at the end of the file or on error
+   */
+  size_t _decoder_read(struct ccsv_decoder *decoder, char *dst, size_t size);
+
+  /*
+   * This function starts decompressing again from the start of the file,
+   *   and skips offset decompressed bytes.
+   *
+   * params:
+   *    decoder: pointer to the decoder
+   *    offset: offset in the decompressed bytes
+   *    scratch: buffer the skipped bytes are written to
+   *    scratch_size: size of the buffer
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, or CCSV_ERROR if the file cannot be seeked or is
+   *         shorter
+   */
+  int _decoder_seek(struct ccsv_decoder *decoder, size_t offset, char *scratch, size_t scratch_size);
+
+  /*
+   * This function tells if decompression stopped on corrupt input.
+   *
+   * params:
+   *    decoder: pointer to the decoder
+   *
+   * returns:
+   *    bool: true if the input is corrupt
+   */
+  bool _decoder_failed(const struct ccsv_decoder *decoder);
+
+  /*
+   * This function frees the decoder of the reader.
+   *
+   * params:
+   *    reader: pointer to the reader
+   */
+  void _decoder_free(ccsv_reader *reader);
+
+  /*
+   * This function sets up a watch on a file read in follow mode, so the
+   *   reader wakes up as soon as the file is written to.
+   *
+   * params:
+   *    fp: file pointer of the file
+   *
+   * returns:
+   *    int: inotify descriptor, -1 if the file is polled instead
+   */
+  int _follow_watch(FILE *fp);
+
+  /*
+   * This function waits for bytes appended to a followed file and reads
+   *   them into dst.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *    dst: where to read the bytes
+   *    size: maximum number of bytes to read
+   *    at_record_boundary: true if no partial record is pending, only then
+   *                        the follow timeout applies
+   *
+   * returns:
+   *    size_t: number of bytes read, 0 if the follow timeout expired
+   */
+  size_t _follow_read(ccsv_reader *reader, char *dst, size_t size, bool at_record_boundary);
+
+  /*
+   * This function stops the worker threads of the reader and frees the
+   *   parsed chunks. The reader continues serially from where the caller is.
+   *
+   * params:
+   *    reader: pointer to the reader
+   */
+  void _parallel_stop(ccsv_reader *reader);
+
+  /*
+   * This function hands out the next record parsed by the worker threads.
+   *   If a chunk could not be parsed in parallel, because of quotes that are
+   *   not at field boundaries, the rest of the file is parsed serially.
+   *
+   * params:
+   *    reader: pointer to the reader
+   *
+   * returns:
+   *    int: number of fields in the record
+   *    int: 0, if all rows are read
+   *    int: CCSV_ERNOMEM, if memory allocation failed
+   */
+  int _parse_row_parallel(ccsv_reader *reader);
+
+  /*
+   * This function frees the memory of a reader, including what was allocated
+   * before opening failed. The file pointer is not closed.
+   *
+   * params:
+   *    reader: pointer to the reader
+   */
+  void _free_reader(ccsv_reader *reader);
+
+  /*
+   * This function checks if the reader is ready to be read from.
+   *
+   * returns:
+   *    int: CCSV_SUCCESS, if the reader can be read
+   *    int: CCSV_ERBUFNTALLOC or CCSV_ERNULLFP otherwise
+   */
+  int _validate_reader(ccsv_reader *reader);
+
+  /*
+   * This function allocates size bytes from the arena, adding a chunk if
+   *   the remaining chunks are too small.
+   *
+   * params:
+   *    arena: pointer to the arena
+   *    size: number of bytes to allocate
+   *
+   * returns:
+   *    void*: pointer to the allocated memory, NULL if memory allocation failed
+   */
+  void *_arena_alloc(ccsv_arena *arena, size_t size);
+
+  /*
+   * This function releases a row allocated from the arena, and resets the
+   *   arena when no allocated rows are left.
+   *
+   * params:
+   *    arena: pointer to the arena
+   */
+  void _arena_release(ccsv_arena *arena);
+
+  /*
+   * This function makes all chunks of the arena reusable.
+   *
+   * params:
+   *    arena: pointer to the arena
+   */
+  void _arena_reset(ccsv_arena *arena);
+
+  /*
+   * This function frees all chunks of the arena.
+   *
+   * params:
+   *    arena: pointer to the arena
+   */
+  void _arena_free(ccsv_arena *arena);
+
+  /*
+   * This functions checks if the reader buffer is empty.
+   */
+  int _is_buffer_empty(ccsv_reader *reader);
+
+  /*
+   *This function frees multiple pointers.
+   *
+   * params:
+   *      num: number of pointers to free
+   *      ...: pointers to free
+   *
+   */
+  void _free_multiple(int num, ...);
 
   /*
    * This function writes a field to the file pointer.
@@ -402,6 +1998,21 @@ extern "C"
    */
   int _write_field(FILE *fp, ccsv_writer *writer, const char *string);
 
+  /*
+   * This function writes a field of known length to the file pointer, the
+   *   field is not scanned for a NUL terminator.
+   *
+   * params:
+   *   fp: file pointer
+   *   writer: pointer to the writer
+   *   string: pointer to the field
+   *   string_len: length of the field
+   *
+   * returns:
+   *    int: WRITE_SUCCESS, or WRITE_ERNOTSTARTED if the row was not started
+   */
+  int _write_field_len(FILE *fp, ccsv_writer *writer, const char *string, size_t string_len);
+
   /*
    *This function writes a row start to the file pointer.
    *
@@ -68,7 +68,7 @@ static PyObject *CCSVReader_Next(PyObject *self, PyObject *args)
 
   for (int i = 0; i < row->fields_count; i++)
   {
-    PyList_SetItem(list, i, PyUnicode_FromString(row->fields[i]));
+    PyList_SetItem(list, i, PyUnicode_FromStringAndSize(row->fields[i], row->lengths[i]));
   }
 
   ccsv_free_row(row);
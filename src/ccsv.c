@@ -31,9 +31,88 @@
     SOFTWARE.
 */
 
+/* Anonymous mappings are not part of strict POSIX */
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/*
+ * Define CCSV_NO_MMAP to always read through stdio buffers.
+ */
+#if !defined(CCSV_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define CCSV_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Define CCSV_NO_THREADS to leave out the parallel reader and read-ahead.
+ * Both need POSIX threads, the parallel reader parses mapped files only.
+ */
+#if !defined(CCSV_NO_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#define CCSV_THREADS
+#include <pthread.h>
+#include <fcntl.h>
+#endif
+
+/*
+ * Define CCSV_NO_INOTIFY to follow files by polling only.
+ * With inotify, a followed file is read again as soon as it is written to.
+ */
+#if !defined(CCSV_NO_INOTIFY) && defined(__linux__)
+#define CCSV_INOTIFY
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Define CCSV_NO_SIMD to build the scalar scanner only.
+ * SSE2 is the x86-64 baseline, AVX2 and AVX-512 kernels are selected at
+ * runtime when the CPU supports them.
+ */
+#if !defined(CCSV_NO_SIMD) && defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define CCSV_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Define CCSV_ZLIB and link with -lz to read gzip files, define CCSV_ZSTD and
+ * link with -lzstd to read zstd files. Compressed files are recognized by
+ * their magic bytes and decompressed as the reader buffer is filled.
+ */
+#ifdef CCSV_ZLIB
+#include <limits.h>
+#include <zlib.h>
+#endif
+
+#ifdef CCSV_ZSTD
+#include <zstd.h>
+#endif
+
+/*
+ * Define CCSV_STATS to keep the counters returned by ccsv_reader_stats().
+ * Without it the counting is compiled out of the parser.
+ */
+#ifdef CCSV_STATS
+#define CCSV_STAT_ADD(reader, counter, n) ((reader)->__stats.counter += (n))
+#else
+#define CCSV_STAT_ADD(reader, counter, n) ((void)0)
+#endif
 
 #ifdef __cplusplus
 extern "C"
@@ -99,40 +178,739 @@ extern "C"
     return 0;
   }
 
+/* Structural scanning */
+
+  typedef size_t (*ccsv_scan_fn)(const char *buffer, size_t pos, size_t end, const char *needles);
+
+  static size_t _find_special_scalar(const char *buffer, size_t pos, size_t end, const char *needles)
+  {
+    const char a = needles[0], b = needles[1], c = needles[2], d = needles[3];
+    for (; pos < end; pos++)
+    {
+      const char ch = buffer[pos];
+      if (ch == a || ch == b || ch == c || ch == d)
+        break;
+    }
+    return pos;
+  }
+
+#ifdef CCSV_SIMD_X86
+  static size_t _find_special_sse2(const char *buffer, size_t pos, size_t end, const char *needles)
+  {
+    const __m128i a = _mm_set1_epi8(needles[0]);
+    const __m128i b = _mm_set1_epi8(needles[1]);
+    const __m128i c = _mm_set1_epi8(needles[2]);
+    const __m128i d = _mm_set1_epi8(needles[3]);
+
+    for (; pos + 16 <= end; pos += 16)
+    {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(buffer + pos));
+      const __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, b)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, c), _mm_cmpeq_epi8(v, d)));
+      const int mask = _mm_movemask_epi8(eq);
+      if (mask != 0)
+        return pos + __builtin_ctz(mask);
+    }
+    return _find_special_scalar(buffer, pos, end, needles);
+  }
+
+  __attribute__((target("avx2"))) static size_t _find_special_avx2(const char *buffer, size_t pos, size_t end, const char *needles)
+  {
+    const __m256i a = _mm256_set1_epi8(needles[0]);
+    const __m256i b = _mm256_set1_epi8(needles[1]);
+    const __m256i c = _mm256_set1_epi8(needles[2]);
+    const __m256i d = _mm256_set1_epi8(needles[3]);
+
+    for (; pos + 32 <= end; pos += 32)
+    {
+      const __m256i v = _mm256_loadu_si256((const __m256i *)(buffer + pos));
+      const __m256i eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, a), _mm256_cmpeq_epi8(v, b)),
+                                         _mm256_or_si256(_mm256_cmpeq_epi8(v, c), _mm256_cmpeq_epi8(v, d)));
+      const unsigned int mask = (unsigned int)_mm256_movemask_epi8(eq);
+      if (mask != 0)
+        return pos + __builtin_ctz(mask);
+    }
+    return _find_special_sse2(buffer, pos, end, needles);
+  }
+
+  __attribute__((target("avx512f,avx512bw"))) static size_t _find_special_avx512(const char *buffer, size_t pos, size_t end, const char *needles)
+  {
+    const __m512i a = _mm512_set1_epi8(needles[0]);
+    const __m512i b = _mm512_set1_epi8(needles[1]);
+    const __m512i c = _mm512_set1_epi8(needles[2]);
+    const __m512i d = _mm512_set1_epi8(needles[3]);
+
+    for (; pos + 64 <= end; pos += 64)
+    {
+      const __m512i v = _mm512_loadu_si512((const void *)(buffer + pos));
+      const __mmask64 mask = _mm512_cmpeq_epi8_mask(v, a) | _mm512_cmpeq_epi8_mask(v, b) |
+                             _mm512_cmpeq_epi8_mask(v, c) | _mm512_cmpeq_epi8_mask(v, d);
+      if (mask != 0)
+        return pos + __builtin_ctzll(mask);
+    }
+    return _find_special_avx2(buffer, pos, end, needles);
+  }
+
+  static ccsv_scan_fn _select_scan_kernel(void)
+  {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+      return _find_special_avx512;
+    if (__builtin_cpu_supports("avx2"))
+      return _find_special_avx2;
+    return _find_special_sse2;
+  }
+
+  /* Set by _init_kernels(), readers may be set up on other threads while it is read */
+  static ccsv_scan_fn _scan_kernel = NULL;
+
+// Kernel pointers are only read through this, a relaxed load is a plain load on x86
+#define CCSV_KERNEL(kernel) __atomic_load_n(&(kernel), __ATOMIC_RELAXED)
+#endif
+
+  /*
+   * Returns the offset of the first byte in [pos, end) equal to one of the
+   * four needles, or end. Most fields are short, so the first 16 bytes are
+   * checked inline before calling the widest kernel the CPU supports.
+   */
+  static inline size_t _find_special(const char *buffer, size_t pos, size_t end, const char *needles)
+  {
+#ifdef CCSV_SIMD_X86
+    if (pos + 16 <= end)
+    {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(buffer + pos));
+      const __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(needles[0])),
+                                                   _mm_cmpeq_epi8(v, _mm_set1_epi8(needles[1]))),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(needles[2])),
+                                                   _mm_cmpeq_epi8(v, _mm_set1_epi8(needles[3]))));
+      const int mask = _mm_movemask_epi8(eq);
+      if (mask != 0)
+        return pos + __builtin_ctz(mask);
+      pos += 16;
+    }
+
+    return CCSV_KERNEL(_scan_kernel)(buffer, pos, end, needles);
+#else
+    return _find_special_scalar(buffer, pos, end, needles);
+#endif
+  }
+
+/* UTF-8 validation */
+
+  typedef bool (*ccsv_utf8_fn)(const unsigned char *data, size_t len, bool *ascii);
+
+  static const unsigned char UTF8_BOM[3] = {0xef, 0xbb, 0xbf};
+
+  static inline bool _utf8_is_ascii(const unsigned char *data, size_t len)
+  {
+    uint64_t bits = 0;
+    size_t pos = 0;
+    for (; pos + 8 <= len; pos += 8)
+    {
+      uint64_t word;
+      memcpy(&word, data + pos, sizeof(word));
+      bits |= word;
+    }
+    for (; pos < len; pos++)
+      bits |= data[pos];
+    return (bits & 0x8080808080808080ULL) == 0;
+  }
+
+  /* End of the bytes in [start, end) without a multibyte sequence cut at the end */
+  static size_t _utf8_complete_end(const unsigned char *data, size_t start, size_t end)
+  {
+    for (size_t back = 1; back <= 3 && end - back >= start && end >= back; back++)
+    {
+      const unsigned char c = data[end - back];
+      if ((c & 0xc0) == 0x80)
+        continue; /* Continuation byte, the lead byte is further back */
+      if (c < 0x80)
+        return end;
+      const size_t needed = c >= 0xf0 ? 4 : (c >= 0xe0 ? 3 : 2);
+      return needed > back ? end - back : end;
+    }
+    return end;
+  }
+
+  static bool _utf8_validate_scalar(const unsigned char *data, size_t len, bool *ascii)
+  {
+    bool all_ascii = true;
+    size_t pos = 0;
+    while (pos < len)
+    {
+      /* Runs of ASCII are skipped 8 bytes at a time */
+      if (pos + 8 <= len)
+      {
+        uint64_t word;
+        memcpy(&word, data + pos, sizeof(word));
+        if ((word & 0x8080808080808080ULL) == 0)
+        {
+          pos += 8;
+          continue;
+        }
+      }
+
+      const unsigned char c = data[pos];
+      if (c < 0x80)
+      {
+        pos++;
+        continue;
+      }
+      all_ascii = false;
+
+      size_t count;
+      unsigned char low = 0x80, high = 0xbf; /* Range of the second byte */
+      if (c >= 0xc2 && c <= 0xdf)
+        count = 2;
+      else if (c >= 0xe0 && c <= 0xef)
+      {
+        count = 3;
+        if (c == 0xe0)
+          low = 0xa0; /* Overlong */
+        else if (c == 0xed)
+          high = 0x9f; /* Surrogates */
+      }
+      else if (c >= 0xf0 && c <= 0xf4)
+      {
+        count = 4;
+        if (c == 0xf0)
+          low = 0x90; /* Overlong */
+        else if (c == 0xf4)
+          high = 0x8f; /* Above U+10FFFF */
+      }
+      else
+        return false;
+
+      if (pos + count > len || data[pos + 1] < low || data[pos + 1] > high)
+        return false;
+      for (size_t i = 2; i < count; i++)
+        if ((data[pos + i] & 0xc0) != 0x80)
+          return false;
+      pos += count;
+    }
+
+    *ascii = all_ascii;
+    return true;
+  }
+
+#ifdef CCSV_SIMD_X86
+  /*
+   * Keiser and Lemire's lookup validator: each byte is classified by its high
+   * nibble, the low nibble of the byte before and the high nibble of its own,
+   * three table lookups whose AND is non-zero only on an error. Continuations
+   * the lookups cannot see, the third and fourth bytes, are checked against
+   * the lead bytes two and three positions back.
+   */
+#define CCSV_UTF8_TOO_SHORT 0x01
+#define CCSV_UTF8_TOO_LONG 0x02
+#define CCSV_UTF8_OVERLONG_3 0x04
+#define CCSV_UTF8_TOO_LARGE 0x08
+#define CCSV_UTF8_SURROGATE 0x10
+#define CCSV_UTF8_OVERLONG_2 0x20
+#define CCSV_UTF8_TOO_LARGE_1000 0x40
+#define CCSV_UTF8_OVERLONG_4 0x40
+#define CCSV_UTF8_TWO_CONTS 0x80
+#define CCSV_UTF8_CARRY (CCSV_UTF8_TOO_SHORT | CCSV_UTF8_TOO_LONG | CCSV_UTF8_TWO_CONTS)
+
+// Bytes of input shifted by n positions, the first ones taken from the end of prev
+#define CCSV_UTF8_PREV(input, prev, n) _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+
+  __attribute__((target("avx2"))) static bool _utf8_validate_avx2(const unsigned char *data, size_t len, bool *ascii)
+  {
+    const __m256i byte_1_high_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        CCSV_UTF8_TOO_LONG, CCSV_UTF8_TOO_LONG, CCSV_UTF8_TOO_LONG, CCSV_UTF8_TOO_LONG,
+        CCSV_UTF8_TOO_LONG, CCSV_UTF8_TOO_LONG, CCSV_UTF8_TOO_LONG, CCSV_UTF8_TOO_LONG,
+        (char)CCSV_UTF8_TWO_CONTS, (char)CCSV_UTF8_TWO_CONTS, (char)CCSV_UTF8_TWO_CONTS, (char)CCSV_UTF8_TWO_CONTS,
+        CCSV_UTF8_TOO_SHORT | CCSV_UTF8_OVERLONG_2,
+        CCSV_UTF8_TOO_SHORT,
+        CCSV_UTF8_TOO_SHORT | CCSV_UTF8_OVERLONG_3 | CCSV_UTF8_SURROGATE,
+        CCSV_UTF8_TOO_SHORT | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000 | CCSV_UTF8_OVERLONG_4));
+    const __m256i byte_1_low_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_OVERLONG_3 | CCSV_UTF8_OVERLONG_2 | CCSV_UTF8_OVERLONG_4),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_OVERLONG_2),
+        (char)CCSV_UTF8_CARRY, (char)CCSV_UTF8_CARRY,
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000 | CCSV_UTF8_SURROGATE),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000),
+        (char)(CCSV_UTF8_CARRY | CCSV_UTF8_TOO_LARGE | CCSV_UTF8_TOO_LARGE_1000)));
+    const __m256i byte_2_high_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        CCSV_UTF8_TOO_SHORT, CCSV_UTF8_TOO_SHORT, CCSV_UTF8_TOO_SHORT, CCSV_UTF8_TOO_SHORT,
+        CCSV_UTF8_TOO_SHORT, CCSV_UTF8_TOO_SHORT, CCSV_UTF8_TOO_SHORT, CCSV_UTF8_TOO_SHORT,
+        (char)(CCSV_UTF8_TOO_LONG | CCSV_UTF8_OVERLONG_2 | CCSV_UTF8_TWO_CONTS | CCSV_UTF8_OVERLONG_3 |
+               CCSV_UTF8_TOO_LARGE_1000 | CCSV_UTF8_OVERLONG_4),
+        (char)(CCSV_UTF8_TOO_LONG | CCSV_UTF8_OVERLONG_2 | CCSV_UTF8_TWO_CONTS | CCSV_UTF8_OVERLONG_3 |
+               CCSV_UTF8_TOO_LARGE),
+        (char)(CCSV_UTF8_TOO_LONG | CCSV_UTF8_OVERLONG_2 | CCSV_UTF8_TWO_CONTS | CCSV_UTF8_SURROGATE |
+               CCSV_UTF8_TOO_LARGE),
+        (char)(CCSV_UTF8_TOO_LONG | CCSV_UTF8_OVERLONG_2 | CCSV_UTF8_TWO_CONTS | CCSV_UTF8_SURROGATE |
+               CCSV_UTF8_TOO_LARGE),
+        CCSV_UTF8_TOO_SHORT, CCSV_UTF8_TOO_SHORT, CCSV_UTF8_TOO_SHORT, CCSV_UTF8_TOO_SHORT));
+
+    /* Lead bytes in the last three positions that need bytes of the next block */
+    const __m256i incomplete_max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    bool all_ascii = true;
+
+    for (size_t pos = 0; pos < len; pos += 32)
+    {
+      __m256i input;
+      if (pos + 32 <= len)
+        input = _mm256_loadu_si256((const __m256i *)(data + pos));
+      else
+      {
+        /* Padded with NUL bytes, which are ASCII */
+        unsigned char tail[32] = {0};
+        memcpy(tail, data + pos, len - pos);
+        input = _mm256_loadu_si256((const __m256i *)tail);
+      }
+
+      if (_mm256_movemask_epi8(input) == 0)
+      {
+        /* A sequence cut by an ASCII block is an error */
+        error = _mm256_or_si256(error, prev_incomplete);
+        continue;
+      }
+      all_ascii = false;
+
+      const __m256i prev1 = CCSV_UTF8_PREV(input, prev_input, 1);
+      const __m256i byte_1_high =
+          _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble));
+      const __m256i byte_1_low = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, low_nibble));
+      const __m256i byte_2_high =
+          _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble));
+      const __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+      /* 0x80 where a three or four byte lead two or three positions back wants a continuation */
+      const __m256i third_byte = _mm256_subs_epu8(CCSV_UTF8_PREV(input, prev_input, 2), _mm256_set1_epi8(0xe0 - 0x80));
+      const __m256i fourth_byte =
+          _mm256_subs_epu8(CCSV_UTF8_PREV(input, prev_input, 3), _mm256_set1_epi8((char)(0xf0 - 0x80)));
+      const __m256i must_be_continuation =
+          _mm256_and_si256(_mm256_or_si256(third_byte, fourth_byte), _mm256_set1_epi8((char)0x80));
+
+      error = _mm256_or_si256(error, _mm256_xor_si256(must_be_continuation, special));
+      prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+      prev_input = input;
+    }
+    error = _mm256_or_si256(error, prev_incomplete);
+
+    *ascii = all_ascii;
+    return _mm256_testz_si256(error, error) != 0;
+  }
+
+  static ccsv_utf8_fn _select_utf8_kernel(void)
+  {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return _utf8_validate_avx2;
+    return _utf8_validate_scalar;
+  }
+
+  /* Set by _init_kernels() */
+  static ccsv_utf8_fn _utf8_kernel = NULL;
+#endif
+
+  /* Validates complete sequences in data, and tells whether they are all ASCII */
+  static inline bool _utf8_validate(const unsigned char *data, size_t len, bool *ascii)
+  {
+#ifdef CCSV_SIMD_X86
+    return CCSV_KERNEL(_utf8_kernel)(data, len, ascii);
+#else
+    return _utf8_validate_scalar(data, len, ascii);
+#endif
+  }
+
+  static inline bool _fields_ascii(const ccsv_field_view *fields, int fields_count)
+  {
+    for (int i = 0; i < fields_count; i++)
+      if (!_utf8_is_ascii((const unsigned char *)fields[i].data, fields[i].len))
+        return false;
+    return true;
+  }
+
+/* Structural index */
+
+  /*
+   * Stage 1 classifies 64 bytes at a time into quote, delimiter and
+   * terminator bitmaps. Quoted regions are found with a prefix XOR over the
+   * quote bitmap, so delimiters and terminators inside quotes drop out
+   * without a branch per byte. The positions of the remaining structural
+   * bytes are appended to the index for stage 2 to walk.
+   */
+  // Set on a position when the field it ends holds escaped quotes
+#define CCSV_INDEX_ESCAPED 0x80000000u
+
+  // Same flag on the field offsets handed to stage 2
+#define CCSV_FIELD_ESCAPED (~(SIZE_MAX >> 1))
+
+  typedef int (*ccsv_index_fn)(ccsv_index *index, const char *buffer, size_t start, size_t end,
+                               char delim, char quote);
+
+  /* Bit i of the result is the XOR of bits 0..i, i.e. set inside quotes */
+  static inline uint64_t _prefix_xor(uint64_t bits)
+  {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+  }
+
+  static inline int _ctz64(uint64_t bits)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int n = 0;
+    while ((bits & 1) == 0)
+    {
+      bits >>= 1;
+      n++;
+    }
+    return n;
+#endif
+  }
+
+  /*
+   * Indexes one block at offset pos of the window given its bitmaps,
+   * quote_prefix being the prefix XOR of the quote bitmap. Returns non-zero
+   * if a quote is not at a field boundary.
+   */
+  static inline uint64_t _index_block(ccsv_index *index, size_t pos, size_t len, uint64_t quote_prefix,
+                                      uint64_t delims, uint64_t terminators)
+  {
+    const uint64_t valid = len < 64 ? ((uint64_t)1 << len) - 1 : ~(uint64_t)0;
+    const int last = (int)len - 1;
+
+    const uint64_t quotes = (quote_prefix ^ (quote_prefix << 1)) & valid;
+    const uint64_t inside = quote_prefix ^ index->in_quotes;
+    index->in_quotes = (uint64_t)0 - (inside >> 63);
+
+    uint64_t structurals = (delims | terminators) & ~inside & valid;
+    const uint64_t opening = quotes & inside;
+    const uint64_t closing = quotes & ~inside;
+
+    /*
+     * Only quotes that open right after a field boundary and close right
+     * before one (or before the second quote of an escaped pair) can be
+     * described by the index. Anything else, like a quote inside an
+     * unquoted field, is left to the state machine.
+     */
+    const uint64_t boundary = structurals | closing;
+    const uint64_t next_ok = structurals | opening;
+    uint64_t misplaced = opening & ~((boundary << 1) | index->prev_boundary);
+    misplaced |= closing & ~(next_ok >> 1) & (valid >> 1);
+    misplaced |= index->pending_close & ~next_ok & 1;
+
+    /* Second quote of each "" pair, the fields holding them need unescaping */
+    uint64_t escapes = opening & ((closing << 1) | index->pending_close);
+
+    index->prev_boundary = (boundary >> last) & 1;
+    index->pending_close = (closing >> last) & 1;
+
+    uint32_t *positions = index->positions;
+    size_t count = index->count;
+    uint32_t escaped = index->pending_escape;
+
+    while (structurals != 0)
+    {
+      const uint64_t bit = structurals & (0 - structurals);
+      if (escapes & (bit - 1))
+      {
+        escaped = CCSV_INDEX_ESCAPED;
+        escapes &= ~(bit - 1);
+      }
+      positions[count++] = (uint32_t)(pos + _ctz64(structurals)) | escaped;
+      escaped = 0;
+      structurals ^= bit;
+    }
+
+    index->count = count;
+    index->pending_escape = escaped | (escapes != 0 ? CCSV_INDEX_ESCAPED : 0);
+    return misplaced;
+  }
+
+  /* Declares a stage 1 window loop around a kernel that fills q, d and t for 64 bytes at p */
+#define INDEX_WINDOW_LOOP(CLASSIFY)                                   \
+  uint64_t misplaced = 0;                                             \
+  char block[64];                                                     \
+  for (size_t pos = start; pos < end; pos += 64)                      \
+  {                                                                   \
+    const size_t len = end - pos < 64 ? end - pos : 64;               \
+    const char *p = buffer + pos;                                     \
+    if (len < 64)                                                     \
+    {                                                                 \
+      /* Padding is NUL, masked off by _index_block */                \
+      memcpy(block, p, len);                                          \
+      memset(block + len, 0, 64 - len);                               \
+      p = block;                                                      \
+    }                                                                 \
+    uint64_t q, d, t;                                                 \
+    CLASSIFY;                                                         \
+    misplaced |= _index_block(index, pos - start, len, q, d, t);      \
+  }                                                                   \
+  return misplaced != 0;
+
+#ifdef CCSV_SIMD_X86
+  /* Same as _prefix_xor, as a carry-less multiplication by all ones */
+  __attribute__((target("pclmul"))) static inline uint64_t _prefix_xor_clmul(uint64_t bits)
+  {
+    const __m128i all_ones = _mm_set1_epi8((char)0xFF);
+    return (uint64_t)_mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)bits), all_ones, 0));
+  }
+
+  static inline void _classify_sse2(const char *p, __m128i vq, __m128i vd,
+                                    uint64_t *q, uint64_t *d, uint64_t *t)
+  {
+    const __m128i vcr = _mm_set1_epi8(CCSV_CR);
+    const __m128i vlf = _mm_set1_epi8(CCSV_LF);
+
+    uint64_t quotes = 0, delims = 0, terminators = 0;
+    for (int i = 0; i < 4; i++)
+    {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+      const __m128i term = _mm_or_si128(_mm_cmpeq_epi8(v, vcr), _mm_cmpeq_epi8(v, vlf));
+      quotes |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vq)) << (16 * i);
+      delims |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vd)) << (16 * i);
+      terminators |= (uint64_t)(unsigned int)_mm_movemask_epi8(term) << (16 * i);
+    }
+    *q = _prefix_xor(quotes);
+    *d = delims;
+    *t = terminators;
+  }
+
+  static int _index_window_sse2(ccsv_index *index, const char *buffer, size_t start, size_t end,
+                                char delim, char quote)
+  {
+    const __m128i vq = _mm_set1_epi8(quote);
+    const __m128i vd = _mm_set1_epi8(delim);
+    INDEX_WINDOW_LOOP(_classify_sse2(p, vq, vd, &q, &d, &t))
+  }
+
+  __attribute__((target("avx2,pclmul"))) static inline void _classify_avx2(const char *p, __m256i vq, __m256i vd,
+                                                                         uint64_t *q, uint64_t *d, uint64_t *t)
+  {
+    const __m256i vcr = _mm256_set1_epi8(CCSV_CR);
+    const __m256i vlf = _mm256_set1_epi8(CCSV_LF);
+
+    const __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+    const __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+    const __m256i term_lo = _mm256_or_si256(_mm256_cmpeq_epi8(lo, vcr), _mm256_cmpeq_epi8(lo, vlf));
+    const __m256i term_hi = _mm256_or_si256(_mm256_cmpeq_epi8(hi, vcr), _mm256_cmpeq_epi8(hi, vlf));
+
+    const uint64_t quotes = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vq)) |
+                            (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vq)) << 32;
+    *d = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vd)) |
+         (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vd)) << 32;
+    *t = (uint64_t)(uint32_t)_mm256_movemask_epi8(term_lo) |
+         (uint64_t)(uint32_t)_mm256_movemask_epi8(term_hi) << 32;
+    *q = _prefix_xor_clmul(quotes);
+  }
+
+  __attribute__((target("avx2,pclmul"))) static int _index_window_avx2(ccsv_index *index, const char *buffer,
+                                                                      size_t start, size_t end,
+                                                                      char delim, char quote)
+  {
+    const __m256i vq = _mm256_set1_epi8(quote);
+    const __m256i vd = _mm256_set1_epi8(delim);
+    INDEX_WINDOW_LOOP(_classify_avx2(p, vq, vd, &q, &d, &t))
+  }
+
+  __attribute__((target("avx512f,avx512bw,pclmul"))) static int _index_window_avx512(ccsv_index *index, const char *buffer,
+                                                                                    size_t start, size_t end,
+                                                                                    char delim, char quote)
+  {
+    const __m512i vq = _mm512_set1_epi8(quote);
+    const __m512i vd = _mm512_set1_epi8(delim);
+    const __m512i vcr = _mm512_set1_epi8(CCSV_CR);
+    const __m512i vlf = _mm512_set1_epi8(CCSV_LF);
+    INDEX_WINDOW_LOOP(
+        const __m512i v = _mm512_loadu_si512((const void *)p);
+        q = _prefix_xor_clmul(_mm512_cmpeq_epi8_mask(v, vq));
+        d = _mm512_cmpeq_epi8_mask(v, vd);
+        t = _mm512_cmpeq_epi8_mask(v, vcr) | _mm512_cmpeq_epi8_mask(v, vlf))
+  }
+
+  static ccsv_index_fn _select_index_kernel(void)
+  {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("pclmul"))
+      return _index_window_avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul"))
+      return _index_window_avx2;
+    return _index_window_sse2;
+  }
+#else
+  static inline void _classify_scalar(const char *p, char delim, char quote,
+                                      uint64_t *q, uint64_t *d, uint64_t *t)
+  {
+    uint64_t quotes = 0, delims = 0, terminators = 0;
+    for (int i = 0; i < 64; i++)
+    {
+      const char ch = p[i];
+      quotes |= (uint64_t)(ch == quote) << i;
+      delims |= (uint64_t)(ch == delim) << i;
+      terminators |= (uint64_t)IS_TERMINATOR(ch) << i;
+    }
+    *q = _prefix_xor(quotes);
+    *d = delims;
+    *t = terminators;
+  }
+
+  static int _index_window_scalar(ccsv_index *index, const char *buffer, size_t start, size_t end,
+                                  char delim, char quote)
+  {
+    INDEX_WINDOW_LOOP(_classify_scalar(p, delim, quote, &q, &d, &t))
+  }
+#endif
+
+#ifdef CCSV_SIMD_X86
+  /* Set by _init_kernels() */
+  static ccsv_index_fn _index_kernel = NULL;
+#else
+  static const ccsv_index_fn _index_kernel = _index_window_scalar;
+
+#define CCSV_KERNEL(kernel) (kernel)
+#endif
+
+/* CPU dispatch */
+
+  /*
+   * Picks the kernels for this CPU when a reader is set up, before it or its
+   * worker threads parse anything. Readers set up at the same time on other
+   * threads store the same pointers.
+   */
+  static void _init_kernels(void)
+  {
+#ifdef CCSV_SIMD_X86
+    if (__atomic_load_n(&_scan_kernel, __ATOMIC_ACQUIRE) != NULL)
+      return;
+    __atomic_store_n(&_index_kernel, _select_index_kernel(), __ATOMIC_RELAXED);
+    __atomic_store_n(&_utf8_kernel, _select_utf8_kernel(), __ATOMIC_RELAXED);
+    /* Stored last, once it is set all kernels are */
+    __atomic_store_n(&_scan_kernel, _select_scan_kernel(), __ATOMIC_RELEASE);
+#endif
+  }
+
+/* Statistics */
+
+#ifdef CCSV_STATS
+  /* Monotonic clock in nanoseconds */
+  static uint64_t _stats_clock(void)
+  {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+  }
+
+  static void _stats_row(ccsv_reader *reader, int fields_count)
+  {
+    ccsv_stats *stats = &reader->__stats;
+    stats->rows++;
+    stats->fields += (uint64_t)fields_count;
+    if (fields_count > stats->max_row_width)
+      stats->max_row_width = fields_count;
+
+    const ccsv_field_view *fields = reader->__row_view.fields;
+    for (int i = 0; i < fields_count; i++)
+      if (fields[i].len > stats->max_field_length)
+        stats->max_field_length = fields[i].len;
+  }
+#endif
+
+  int ccsv_reader_stats(ccsv_reader *reader, ccsv_stats *stats)
+  {
+    if (reader == NULL || stats == NULL)
+      return CCSV_ERINVALID;
+
+#ifdef CCSV_STATS
+    *stats = reader->__stats;
+    return CCSV_SUCCESS;
+#else
+    memset(stats, 0, sizeof(ccsv_stats));
+    return CCSV_ERROR;
+#endif
+  }
+
 /* Reader */
 
-// These macros should be used only in _next function
-#define ADD_FIELD(field)                                                   \
-  do                                                                       \
-  {                                                                        \
-    field[field_pos++] = CCSV_NULL_CHAR;                                   \
-    fields_count++;                                                        \
-    char **temp = (char **)realloc(fields, sizeof(char *) * fields_count); \
-    if (temp == NULL)                                                      \
-    {                                                                      \
-      _free_multiple(3, field, row_string, row);                           \
-      reader->status = CCSV_ERNOMEM;                                       \
-      return NULL;                                                         \
-    }                                                                      \
-    fields = temp;                                                         \
-    fields[fields_count - 1] = field;                                      \
+// Returned by the structural index when a record has to go through the state machine
+#define CCSV_INDEX_FALLBACK -100
+
+// Most buffer fills parsed by the state machine after the index falls back
+#define CCSV_INDEX_MAX_BACKOFF 64
+
+// Set in a saved reader offset if the LF of a CRLF is the first byte at the offset
+#define CCSV_OFFSET_SKIP_LF ((uint64_t)1 << 63)
+
+// These macros should be used only in _parse_row function
+#define ADD_FIELD()                                                     \
+  do                                                                    \
+  {                                                                     \
+    if (fields_count == reader->__fields_capacity &&                    \
+        _grow_fields(reader, fields_count + 1) != CCSV_SUCCESS)         \
+      return CCSV_ERNOMEM;                                              \
+    buffer[field_pos] = CCSV_NULL_CHAR;                                 \
+    reader->__field_starts[fields_count] = field_start;                 \
+    reader->__fields[fields_count].len = field_pos - field_start;       \
+    fields_count++;                                                     \
+  } while (0)
+
+#define END_FIELD()                         \
+  do                                        \
+  {                                         \
+    ADD_FIELD();                            \
+    field_start = field_pos = row_pos;      \
+    state = FIELD_START;                    \
+  } while (0)
+
+#define END_ROW() \
+  do              \
+  {               \
+    ADD_FIELD();  \
+    goto end;     \
+  } while (0)
+
+/* Appends the bytes up to the next special character to the field in one go */
+#define COPY_RUN(needles)                                                              \
+  do                                                                                   \
+  {                                                                                    \
+    const size_t run_end = _find_special(buffer, row_pos, buffer_size, needles);       \
+    if (field_pos != row_pos)                                                          \
+      memmove(buffer + field_pos, buffer + row_pos, run_end - row_pos);                \
+    field_pos += run_end - row_pos;                                                    \
+    row_pos = run_end;                                                                 \
   } while (0)
 
-#define GROW_FIELD_BUFFER_IF_NEEDED(field, field_size, field_pos) \
-  do                                                              \
-  {                                                               \
-    if (field_pos > field_size - 1)                               \
-    {                                                             \
-      field_size += MAX_FIELD_SIZE;                               \
-      char *temp = (char *)realloc(field, field_size + 1);        \
-      if (temp == NULL)                                           \
-      {                                                           \
-        _free_multiple(3, fields, row_string, row);               \
-        reader->status = CCSV_ERNOMEM;                            \
-        return NULL;                                              \
-      }                                                           \
-      field = temp;                                               \
-    }                                                             \
+#define SKIP_LINE()                                   \
+  do                                                  \
+  {                                                   \
+    CCSV_STAT_ADD(reader, lines_skipped, 1);          \
+    skip_lf = c == CCSV_CR;                           \
+    row_start = field_start = field_pos = row_pos;    \
+    state = FIELD_START;                              \
   } while (0)
 
 // Writer macros
@@ -142,8 +920,14 @@ extern "C"
 
   ccsv_reader *ccsv_init_reader(ccsv_reader_options *options, short *status)
   {
+    _init_kernels();
+
     char delim, quote_char, comment_char, escape_char;
-    int skip_initial_space, skip_empty_lines, skip_comments;
+    int skip_initial_space, skip_empty_lines, skip_comments, use_arena, use_mmap, threads, read_ahead;
+    int follow, follow_timeout, has_header, validate_utf8;
+    const int *usecols = NULL;
+    const char **usecols_names = NULL;
+    int usecols_count = 0;
     if (options == NULL)
     {
       delim = DEFAULT_DELIMITER;
@@ -153,6 +937,14 @@ extern "C"
       skip_initial_space = 0;
       skip_empty_lines = 0;
       skip_comments = 0;
+      use_arena = 0;
+      use_mmap = 0;
+      threads = 0;
+      read_ahead = 0;
+      follow = 0;
+      follow_timeout = 0;
+      has_header = 0;
+      validate_utf8 = 0;
     }
     else
     {
@@ -199,6 +991,61 @@ extern "C"
 
       else
         skip_comments = options->skip_comments;
+
+      if (options->use_arena == CCSV_NULL_CHAR)
+        use_arena = 0;
+
+      else
+        use_arena = options->use_arena;
+
+      if (options->use_mmap == CCSV_NULL_CHAR)
+        use_mmap = 0;
+
+      else
+        use_mmap = options->use_mmap;
+
+      if (options->threads == CCSV_NULL_CHAR)
+        threads = 0;
+
+      else
+        threads = options->threads;
+
+      if (options->read_ahead == CCSV_NULL_CHAR)
+        read_ahead = 0;
+
+      else
+        read_ahead = options->read_ahead;
+
+      if (options->follow == CCSV_NULL_CHAR)
+        follow = 0;
+
+      else
+        follow = options->follow;
+
+      if (options->follow_timeout == CCSV_NULL_CHAR)
+        follow_timeout = 0;
+
+      else
+        follow_timeout = options->follow_timeout;
+
+      if (options->has_header == CCSV_NULL_CHAR)
+        has_header = 0;
+
+      else
+        has_header = options->has_header;
+
+      if (options->validate_utf8 == CCSV_NULL_CHAR)
+        validate_utf8 = 0;
+
+      else
+        validate_utf8 = options->validate_utf8;
+
+      if (options->usecols != NULL || options->usecols_names != NULL)
+      {
+        usecols = options->usecols;
+        usecols_names = options->usecols_names;
+        usecols_count = options->usecols_count;
+      }
     }
 
     // Parser
@@ -216,8 +1063,88 @@ extern "C"
     parser->__skip_initial_space = skip_initial_space;
     parser->__skip_empty_lines = skip_empty_lines;
     parser->__skip_comments = skip_comments;
+    parser->__use_arena = use_arena;
+    parser->__use_mmap = use_mmap;
+    parser->__threads = threads;
+    parser->__parallel = NULL;
+    parser->__read_ahead_buffers = read_ahead;
+    parser->__read_ahead = NULL;
+    parser->__decoder = NULL;
+    parser->__follow = follow;
+    parser->__follow_timeout = follow_timeout;
+    parser->__follow_fd = -1;
+    parser->__push = false;
+    parser->__seekable = false;
+    parser->__resume.pending = false;
+    parser->__has_header = has_header != 0;
+    parser->__header_pending = has_header != 0;
+    parser->__header = NULL;
+    parser->__validate_utf8 = validate_utf8;
+    parser->__utf8_invalid = false;
+    parser->__buffer_ascii = true;
+    parser->__utf8_checked = 0;
+    parser->__bom_size = 0;
+    memset(&parser->__stats, 0, sizeof(ccsv_stats));
+    if (follow > 0)
+    {
+      /* A followed file keeps growing, it is read through the buffer on the calling thread */
+      parser->__use_mmap = 0;
+      parser->__read_ahead_buffers = 0;
+    }
 
     parser->__fp = NULL;
+    parser->__buffer = NULL;
+    parser->__buffer_pos = 0;
+    parser->__buffer_size = 0;
+    parser->__buffer_capacity = 0;
+    parser->__eof = false;
+    parser->__skip_lf = false;
+    parser->__mapped = false;
+    parser->__map_dirty = false;
+    parser->__map_size = 0;
+    parser->__scratch = NULL;
+    parser->__scratch_capacity = 0;
+
+    parser->__fields = NULL;
+    parser->__field_starts = NULL;
+    parser->__fields_capacity = 0;
+    parser->__row_view.fields = NULL;
+    parser->__row_view.fields_count = 0;
+    parser->__row_view.ascii = false;
+
+    parser->__usecols = NULL;
+    parser->__usecols_count = 0;
+    parser->__usecols_names = NULL;
+    parser->__column_used = NULL;
+    parser->__column_used_count = 0;
+    parser->__projected = NULL;
+    parser->__row_offsets = NULL;
+    parser->__row_offsets_count = 0;
+    parser->__row_interval = 0;
+    if (usecols_count > 0)
+    {
+      const int usecols_status = _init_usecols(parser, usecols, usecols_names, usecols_count);
+      if (usecols_status != CCSV_SUCCESS)
+      {
+        _free_multiple(5, parser->__usecols, parser->__usecols_names, parser->__column_used,
+                       parser->__projected, parser);
+        if (status != NULL)
+          *status = usecols_status;
+        return NULL;
+      }
+    }
+
+    parser->__arena.head = NULL;
+    parser->__arena.current = NULL;
+    parser->__arena.live_rows = 0;
+
+    /* The structural index handles RFC 4180 style quoting, other dialects use the state machine */
+    parser->__index.enabled = escape_char == quote_char && !skip_initial_space && !skip_comments;
+    parser->__index.positions = NULL;
+    parser->__index.backoff = 0;
+    parser->__index.fallback_fills = 0;
+    _index_reset(parser, 0);
+    parser->__index.stale = true;
 
     parser->rows_read = 0;
     parser->status = CCSV_SUCCESS;
@@ -226,8 +1153,55 @@ extern "C"
     return parser;
   }
 
-  void ccsv_free_row(ccsv_row *row)
+  int _init_usecols(ccsv_reader *reader, const int *usecols, const char **usecols_names, int usecols_count)
   {
+    reader->__usecols = (int *)malloc(sizeof(int) * usecols_count);
+    reader->__projected = (ccsv_field_view *)malloc(sizeof(ccsv_field_view) * usecols_count);
+    if (reader->__usecols == NULL || reader->__projected == NULL)
+      return CCSV_ERNOMEM;
+    reader->__usecols_count = usecols_count;
+
+    if (usecols != NULL)
+    {
+      for (int i = 0; i < usecols_count; i++)
+      {
+        if (usecols[i] < 0)
+          return CCSV_ERINVALID;
+        reader->__usecols[i] = usecols[i];
+      }
+      return _mark_used_columns(reader);
+    }
+
+    /* Names are copied into one block, they are looked up when the first record is read */
+    size_t size = sizeof(char *) * usecols_count;
+    for (int i = 0; i < usecols_count; i++)
+      size += strlen(usecols_names[i]) + 1;
+
+    char **names = (char **)malloc(size);
+    if (names == NULL)
+      return CCSV_ERNOMEM;
+
+    char *name = (char *)(names + usecols_count);
+    for (int i = 0; i < usecols_count; i++)
+    {
+      const size_t len = strlen(usecols_names[i]);
+      memcpy(name, usecols_names[i], len + 1);
+      names[i] = name;
+      name += len + 1;
+    }
+    reader->__usecols_names = names;
+    return CCSV_SUCCESS;
+  }
+
+  void ccsv_free_row(ccsv_row *row)
+  {
+    if (row->__arena != NULL)
+    {
+      /* Fields and the row itself live in the arena */
+      _arena_release(row->__arena);
+      return;
+    }
+
     const int fields_count = row->fields_count;
     for (int i = 0; i < fields_count; i++)
     {
@@ -300,7 +1274,7 @@ extern "C"
 
     if (object_type == CCSV_READER)
     {
-      short init_status;
+      short init_status = CCSV_SUCCESS;
 
 #ifdef __cplusplus
       ccsv_reader_options *reader_options = reinterpret_cast<ccsv_reader_options *>(options);
@@ -310,15 +1284,16 @@ extern "C"
     ccsv_reader *reader = ccsv_init_reader(options, &init_status);
 #endif
 
-      if (init_status == CCSV_ERNOMEM || reader == NULL)
+      if (init_status != CCSV_SUCCESS || reader == NULL)
       {
         if (status != NULL)
-          *status = CCSV_ERNOMEM;
+          *status = init_status != CCSV_SUCCESS ? init_status : CCSV_ERNOMEM;
         return NULL;
       }
 
       if (fp == NULL)
       {
+        _free_reader(reader);
         if (status != NULL)
           *status = CCSV_EROPEN;
         return NULL;
@@ -328,12 +1303,47 @@ extern "C"
 
       size_t file_size;
 
-      fseek(fp, 0, SEEK_END);
+      /* Pipes cannot be seeked, their size is unknown */
+      reader->__seekable = fseek(fp, 0, SEEK_END) == 0;
       file_size = ftell(fp);
       fseek(fp, 0, SEEK_SET);
       reader->__file_size = file_size;
       reader->__file_pos = 0;
 
+      const int decoder_status = _decoder_open(reader, fp);
+      if (decoder_status != CCSV_SUCCESS)
+      {
+        _free_reader(reader);
+        if (status != NULL)
+          *status = decoder_status;
+        return NULL;
+      }
+      if (reader->__decoder != NULL)
+      {
+        /* Decompressed bytes only exist in the buffer, their count is not known */
+        reader->__use_mmap = 0;
+        reader->__follow = 0;
+        reader->__file_size = SIZE_MAX;
+        if (reader->__read_ahead_buffers == 0)
+          reader->__read_ahead_buffers = CCSV_DECODER_READ_AHEAD;
+      }
+
+      /* The structural index never writes to the mapping, the state machine would copy every page */
+      if (reader->__use_mmap && reader->__index.enabled && _map_file(reader, fp) == CCSV_SUCCESS &&
+          _utf8_check_mapping(reader) == CCSV_SUCCESS)
+      {
+        CCSV_STAT_ADD(reader, bytes_read, reader->__buffer_size);
+        CCSV_STAT_ADD(reader, refills, 1);
+
+        /* Without threads the reader parses serially */
+        if (reader->__threads > 1)
+          _parallel_start(reader, reader->__threads);
+
+        reader->__fp = fp;
+        reader->object_type = object_type;
+        return reader;
+      }
+
       if (file_size >= CCSV_LARGE_FILE_SIZE)
         buffer_size = CCSV_HIGH_BUFFER_SIZE;
       else if (file_size >= CCSV_MED_FILE_SIZE)
@@ -344,19 +1354,27 @@ extern "C"
       reader->__buffer = (char *)malloc(buffer_size + 1);
       if (reader->__buffer == NULL)
       {
-        free(reader);
+        _free_reader(reader);
         if (status != NULL)
           *status = CCSV_ERNOMEM;
         return NULL;
       }
       reader->__buffer[0] = CCSV_NULL_CHAR;
 
-      reader->__buffer_size = buffer_size;
+      reader->__buffer_capacity = buffer_size;
       // reader->__buffer_allocated = true;
 
       reader->__fp = fp;
       reader->object_type = object_type;
 
+      /* Polling is used if the file cannot be watched */
+      if (reader->__follow > 0)
+        reader->__follow_fd = _follow_watch(fp);
+
+      /* Reading stays synchronous if the thread cannot be started */
+      if (reader->__read_ahead_buffers > 0)
+        _read_ahead_start(reader, reader->__read_ahead_buffers);
+
       return reader;
     }
     else if (object_type == CCSV_WRITER)
@@ -368,326 +1386,4455 @@ extern "C"
         return NULL;
       }
 
-      short init_status;
+      short init_status;
+
+#ifdef __cplusplus
+      ccsv_writer_options *writer_options = reinterpret_cast<ccsv_writer_options *>(options);
+      ccsv_writer *writer = ccsv_init_writer(writer_options, &init_status);
+#else
+    options = (ccsv_writer_options *)options;
+    ccsv_writer *writer = ccsv_init_writer(options, &init_status);
+#endif
+      if (init_status == CCSV_ERNOMEM || writer == NULL)
+      {
+        if (status != NULL)
+          *status = CCSV_ERNOMEM;
+        return NULL;
+      }
+      writer->__fp = fp;
+      writer->object_type = object_type;
+
+      return writer;
+    }
+    return NULL;
+  }
+
+  ccsv_reader *ccsv_open_push(ccsv_reader_options *options, short *status)
+  {
+    short init_status = CCSV_SUCCESS;
+    ccsv_reader *reader = ccsv_init_reader(options, &init_status);
+    if (init_status != CCSV_SUCCESS || reader == NULL)
+    {
+      if (status != NULL)
+        *status = init_status != CCSV_SUCCESS ? init_status : CCSV_ERNOMEM;
+      return NULL;
+    }
+
+    reader->__buffer = (char *)malloc(CCSV_BUFFER_SIZE + 1);
+    if (reader->__buffer == NULL)
+    {
+      ccsv_close(reader);
+      if (status != NULL)
+        *status = CCSV_ERNOMEM;
+      return NULL;
+    }
+    reader->__buffer[0] = CCSV_NULL_CHAR;
+    reader->__buffer_capacity = CCSV_BUFFER_SIZE;
+
+    /* Bytes only arrive through ccsv_feed(), on the calling thread */
+    reader->__push = true;
+    reader->__use_mmap = 0;
+    reader->__threads = 0;
+    reader->__read_ahead_buffers = 0;
+    reader->__follow = 0;
+    reader->__file_size = 0;
+    reader->__file_pos = 0;
+    reader->object_type = CCSV_READER;
+
+    if (status != NULL)
+      *status = CCSV_SUCCESS;
+    return reader;
+  }
+
+  void ccsv_close(void *obj)
+  {
+    if (obj == NULL)
+      return;
+
+    if (_get_object_type(obj) == CCSV_READER)
+    {
+      ccsv_reader *reader = (ccsv_reader *)obj;
+      _parallel_stop(reader);
+      _read_ahead_stop(reader);
+#ifdef CCSV_INOTIFY
+      if (reader->__follow_fd >= 0)
+        close(reader->__follow_fd);
+#endif
+      if (reader->__fp != NULL)
+        fclose(reader->__fp);
+      _free_reader(reader);
+    }
+    else if (_get_object_type(obj) == CCSV_WRITER)
+    {
+      ccsv_writer *writer = (ccsv_writer *)obj;
+      fclose(writer->__fp);
+      free(writer);
+    }
+    else
+    {
+      return;
+    }
+  }
+
+  void _free_reader(ccsv_reader *reader)
+  {
+    _decoder_free(reader);
+    _arena_free(&reader->__arena);
+    free(reader->__index.positions);
+#ifdef CCSV_MMAP
+    if (reader->__mapped)
+    {
+      munmap(reader->__buffer, reader->__map_size);
+      reader->__buffer = NULL;
+    }
+#endif
+    _free_multiple(6, reader->__usecols, reader->__usecols_names, reader->__column_used, reader->__projected,
+                   reader->__row_offsets, reader->__header);
+    _free_multiple(5, reader->__buffer, reader->__fields, reader->__field_starts, reader->__scratch, reader);
+  }
+
+  int _validate_reader(ccsv_reader *reader)
+  {
+    if (reader->__buffer == NULL)
+    {
+      reader->status = CCSV_ERBUFNTALLOC;
+      return CCSV_ERBUFNTALLOC;
+    }
+
+    if (reader->__fp == NULL && !reader->__push)
+    {
+      reader->status = CCSV_ERNULLFP;
+      return CCSV_ERNULLFP;
+    }
+
+    return CCSV_SUCCESS;
+  }
+
+  ccsv_row *ccsv_next(ccsv_reader *reader)
+  {
+    if (reader == NULL)
+      return NULL;
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return NULL;
+
+    return _next(reader);
+  }
+
+  ccsv_row_view *ccsv_next_view(ccsv_reader *reader)
+  {
+    if (reader == NULL)
+      return NULL;
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return NULL;
+
+    if (_parse_row(reader) <= 0)
+      return NULL;
+
+    return &reader->__row_view;
+  }
+
+  int ccsv_next_into(ccsv_reader *reader, ccsv_row *row)
+  {
+    if (reader == NULL)
+      return CCSV_ERINVALID;
+
+    if (row == NULL)
+    {
+      reader->status = CCSV_ERNULLROW;
+      return CCSV_ERNULLROW;
+    }
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    const int fields_count = _parse_row(reader);
+    if (fields_count <= 0)
+      return fields_count;
+
+    if (fields_count > row->__fields_capacity)
+    {
+      if (_grow_row(row, fields_count) != CCSV_SUCCESS)
+      {
+        reader->status = CCSV_ERNOMEM;
+        return CCSV_ERNOMEM;
+      }
+      CCSV_STAT_ADD(reader, fields_grows, 1);
+    }
+
+    const ccsv_field_view *views = reader->__row_view.fields;
+    for (int i = 0; i < fields_count; i++)
+    {
+      const size_t len = views[i].len;
+      const size_t size = len + 1;
+      if (size > row->__field_sizes[i])
+      {
+        /* Longest field seen in this column so far, never shrunk */
+        size_t field_size = row->__field_sizes[i] * 2;
+        if (field_size < MAX_FIELD_SIZE + 1)
+          field_size = MAX_FIELD_SIZE + 1;
+        if (field_size < size)
+          field_size = size;
+
+        char *temp = (char *)realloc(row->fields[i], field_size);
+        if (temp == NULL)
+        {
+          reader->status = CCSV_ERNOMEM;
+          return CCSV_ERNOMEM;
+        }
+        row->fields[i] = temp;
+        row->__field_sizes[i] = field_size;
+        CCSV_STAT_ADD(reader, buffer_grows, 1);
+      }
+
+      memcpy(row->fields[i], views[i].data, len);
+      row->fields[i][len] = CCSV_NULL_CHAR;
+      row->lengths[i] = len;
+    }
+
+    row->fields_count = fields_count;
+    row->ascii = reader->__row_view.ascii;
+    return fields_count;
+  }
+
+  int ccsv_count(ccsv_reader *reader, size_t *rows, size_t *fields)
+  {
+    if (reader == NULL)
+      return CCSV_ERINVALID;
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    size_t rows_count = 0;
+    size_t fields_total = 0;
+
+    for (;;)
+    {
+      const int fields_count = _skip_record(reader);
+      if (fields_count < 0)
+        return fields_count;
+      if (fields_count == 0)
+        break;
+
+      rows_count++;
+      fields_total += fields_count;
+    }
+
+    if (rows != NULL)
+      *rows = rows_count;
+    if (fields != NULL)
+      *fields = fields_total;
+    return CCSV_SUCCESS;
+  }
+
+  int ccsv_feed(ccsv_reader *reader, const char *bytes, size_t len)
+  {
+    if (reader == NULL || !reader->__push || reader->__eof || (bytes == NULL && len > 0))
+      return CCSV_ERINVALID;
+
+    if (reader->__utf8_invalid)
+      return CCSV_ERUTF8;
+
+    const bool end = len == 0;
+    if (reader->__validate_utf8 && reader->__file_pos == 0 && reader->__bom_size < sizeof(UTF8_BOM))
+    {
+      /* A BOM may be split over several calls, its bytes are held back until it is complete */
+      while (len > 0 && reader->__bom_size < sizeof(UTF8_BOM) &&
+             (unsigned char)*bytes == UTF8_BOM[reader->__bom_size])
+      {
+        bytes++;
+        len--;
+        reader->__bom_size++;
+      }
+
+      /* Not a BOM, or the input ended inside it, the held back bytes are data */
+      if (reader->__bom_size < sizeof(UTF8_BOM) && reader->__bom_size > 0 && (len > 0 || end))
+      {
+        const size_t held = reader->__bom_size;
+        reader->__bom_size = 0;
+        const int held_status = _feed_bytes(reader, (const char *)UTF8_BOM, held);
+        if (held_status != CCSV_SUCCESS)
+          return held_status;
+      }
+      else if (len == 0 && !end)
+        return CCSV_SUCCESS;
+    }
+
+    if (end)
+    {
+      /* End of the input, a pending record is returned as the last row */
+      if (reader->__validate_utf8 && _utf8_check_buffer(reader, true) != CCSV_SUCCESS)
+        return CCSV_ERUTF8; /* Not at the end, the record holding the bytes is not returned */
+      reader->__eof = true;
+      return CCSV_SUCCESS;
+    }
+
+    return _feed_bytes(reader, bytes, len);
+  }
+
+  int _feed_bytes(ccsv_reader *reader, const char *bytes, size_t len)
+  {
+    char *buffer = reader->__buffer;
+    if (reader->__buffer_capacity - reader->__buffer_size < len)
+    {
+      /* Drop the rows already read, a partial record is at __buffer_pos */
+      const size_t keep_from = reader->__buffer_pos;
+      const size_t keep = reader->__buffer_size - keep_from;
+      if (keep_from > 0)
+      {
+        memmove(buffer, buffer + keep_from, keep);
+        reader->__buffer_pos = 0;
+        reader->__buffer_size = keep;
+        if (reader->__validate_utf8)
+        {
+          reader->__utf8_checked = reader->__utf8_checked > keep_from ? reader->__utf8_checked - keep_from : 0;
+          if (!reader->__buffer_ascii)
+            reader->__buffer_ascii = _utf8_is_ascii((const unsigned char *)buffer, keep);
+        }
+      }
+
+      if (reader->__buffer_capacity - keep < len)
+      {
+        size_t capacity = reader->__buffer_capacity * 2;
+        if (capacity < keep + len)
+          capacity = keep + len;
+        char *temp = (char *)realloc(buffer, capacity + 1);
+        if (temp == NULL)
+        {
+          reader->status = CCSV_ERNOMEM;
+          return CCSV_ERNOMEM;
+        }
+        buffer = temp;
+        reader->__buffer = buffer;
+        reader->__buffer_capacity = capacity;
+        CCSV_STAT_ADD(reader, buffer_grows, 1);
+      }
+    }
+
+    memcpy(buffer + reader->__buffer_size, bytes, len);
+    reader->__buffer_size += len;
+    buffer[reader->__buffer_size] = CCSV_NULL_CHAR;
+    reader->__file_pos += len;
+    reader->__file_size += len;
+    CCSV_STAT_ADD(reader, bytes_read, len);
+    CCSV_STAT_ADD(reader, refills, 1);
+
+    _index_invalidate(reader);
+    if (reader->__validate_utf8 && _utf8_check_buffer(reader, false) != CCSV_SUCCESS)
+    {
+      /* The fed bytes are dropped, rows read before them are still returned */
+      reader->__buffer_size -= len;
+      buffer[reader->__buffer_size] = CCSV_NULL_CHAR;
+      return CCSV_ERUTF8;
+    }
+    return CCSV_SUCCESS;
+  }
+
+  int ccsv_parse(ccsv_reader *reader, ccsv_field_callback on_field, ccsv_row_callback on_row_end, void *user_data)
+  {
+    if (reader == NULL)
+      return CCSV_ERINVALID;
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    for (;;)
+    {
+      /* Spans are kept in the reader, no row is built */
+      const int fields_count = _parse_row(reader);
+      if (fields_count <= 0)
+        return fields_count;
+
+      const ccsv_field_view *fields = reader->__row_view.fields;
+      if (on_field != NULL)
+      {
+        for (int i = 0; i < fields_count; i++)
+        {
+          const int stop = on_field(fields[i].data, fields[i].len, i, user_data);
+          if (stop != 0)
+            return stop;
+        }
+      }
+
+      if (on_row_end != NULL)
+      {
+        const int stop = on_row_end((size_t)(reader->rows_read - 1), user_data);
+        if (stop != 0)
+          return stop;
+      }
+    }
+  }
+
+  int ccsv_infer_schema(ccsv_reader *reader, size_t sample_rows, ccsv_schema *schema)
+  {
+    if (reader == NULL)
+      return CCSV_ERINVALID;
+
+    /* The sample is read again, the rows are lost if the reader cannot go back */
+    if (schema == NULL || sample_rows == 0 || reader->__push || !reader->__seekable)
+    {
+      reader->status = CCSV_ERINVALID;
+      return CCSV_ERINVALID;
+    }
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    ccsv_position start;
+    ccsv_tell(reader, &start);
+
+    /* Types are dropped from a column as its values fail to convert */
+    const unsigned ALL_TYPES = (1u << CCSV_TYPE_INT64) | (1u << CCSV_TYPE_DOUBLE) | (1u << CCSV_TYPE_BOOL) |
+                               (1u << CCSV_TYPE_DATE) | (1u << CCSV_TYPE_TIMESTAMP);
+    int capacity = schema->columns != NULL ? schema->columns_count : 0;
+    schema->columns_count = 0;
+    schema->rows_sampled = 0;
+    int status = CCSV_SUCCESS;
+
+    while (schema->rows_sampled < sample_rows)
+    {
+      const int fields_count = _parse_row(reader);
+      if (fields_count <= 0)
+      {
+        status = fields_count;
+        break;
+      }
+
+      if (fields_count > schema->columns_count)
+      {
+        if (fields_count > capacity)
+        {
+          ccsv_column_info *columns = (ccsv_column_info *)realloc(schema->columns, sizeof(ccsv_column_info) * fields_count);
+          if (columns == NULL)
+          {
+            status = CCSV_ERNOMEM;
+            break;
+          }
+          schema->columns = columns;
+          capacity = fields_count;
+        }
+
+        /* A column first seen in this row is missing from the rows before it */
+        for (int i = schema->columns_count; i < fields_count; i++)
+        {
+          schema->columns[i].type = CCSV_TYPE_STRING;
+          schema->columns[i].nullable = schema->rows_sampled > 0;
+          schema->columns[i].max_length = 0;
+          schema->columns[i].__candidates = ALL_TYPES;
+        }
+        schema->columns_count = fields_count;
+      }
+
+      const ccsv_field_view *fields = reader->__row_view.fields;
+      for (int i = 0; i < fields_count; i++)
+      {
+        ccsv_column_info *column = &schema->columns[i];
+        if (fields[i].len == 0)
+        {
+          column->nullable = true;
+          continue;
+        }
+        if (fields[i].len > column->max_length)
+          column->max_length = fields[i].len;
+        if (column->__candidates != 0)
+          _infer_value(column, fields[i].data, fields[i].len);
+      }
+      for (int i = fields_count; i < schema->columns_count; i++)
+        schema->columns[i].nullable = true;
+
+      schema->rows_sampled++;
+    }
+
+    /* The sample is read again by the caller */
+    if (ccsv_seek(reader, &start) != CCSV_SUCCESS && status == CCSV_SUCCESS)
+      status = reader->status;
+    if (status != CCSV_SUCCESS)
+      return status;
+
+    static const ccsv_type PREFERRED[] = {CCSV_TYPE_INT64, CCSV_TYPE_DOUBLE, CCSV_TYPE_BOOL, CCSV_TYPE_DATE,
+                                          CCSV_TYPE_TIMESTAMP};
+    for (int i = 0; i < schema->columns_count; i++)
+    {
+      ccsv_column_info *column = &schema->columns[i];
+      column->type = CCSV_TYPE_STRING;
+      if (column->max_length == 0)
+        continue; /* No value to tell the type from */
+      for (size_t t = 0; t < sizeof(PREFERRED) / sizeof(PREFERRED[0]); t++)
+      {
+        if (column->__candidates & (1u << PREFERRED[t]))
+        {
+          column->type = PREFERRED[t];
+          break;
+        }
+      }
+    }
+    return CCSV_SUCCESS;
+  }
+
+  void ccsv_clear_schema(ccsv_schema *schema)
+  {
+    if (schema == NULL)
+      return;
+
+    free(schema->columns);
+    schema->columns = NULL;
+    schema->columns_count = 0;
+    schema->rows_sampled = 0;
+  }
+
+  int _skip_record(ccsv_reader *reader)
+  {
+    if (reader->__header_pending)
+    {
+      const int header_status = _read_header(reader);
+      if (header_status <= 0)
+        return header_status;
+    }
+
+    if (reader->__parallel == NULL && reader->__index.enabled && !reader->__resume.pending)
+    {
+      /* Records are only located, their bytes are never touched */
+      size_t row_start = 0;
+      const int fields_count = _index_next_record(reader, &row_start);
+      if (fields_count > 0)
+        _index_skip_record(reader, fields_count);
+      if (fields_count != CCSV_INDEX_FALLBACK)
+        return fields_count;
+    }
+
+    return _parse_record(reader);
+  }
+
+  int _grow_row(ccsv_row *row, int min_capacity)
+  {
+    int capacity = row->__fields_capacity * 2;
+    if (capacity < min_capacity)
+      capacity = min_capacity;
+
+    char **fields = (char **)realloc(row->fields, sizeof(char *) * capacity);
+    if (fields == NULL)
+      return CCSV_ERNOMEM;
+    row->fields = fields;
+
+    size_t *field_sizes = (size_t *)realloc(row->__field_sizes, sizeof(size_t) * capacity);
+    if (field_sizes == NULL)
+      return CCSV_ERNOMEM;
+    row->__field_sizes = field_sizes;
+
+    size_t *lengths = (size_t *)realloc(row->lengths, sizeof(size_t) * capacity);
+    if (lengths == NULL)
+      return CCSV_ERNOMEM;
+    row->lengths = lengths;
+
+    for (int i = row->__fields_capacity; i < capacity; i++)
+    {
+      fields[i] = NULL;
+      field_sizes[i] = 0;
+    }
+
+    row->__fields_capacity = capacity;
+    return CCSV_SUCCESS;
+  }
+
+  void ccsv_clear_row(ccsv_row *row)
+  {
+    if (row == NULL)
+      return;
+
+    for (int i = 0; i < row->__fields_capacity; i++)
+      free(row->fields[i]);
+
+    _free_multiple(3, row->fields, row->lengths, row->__field_sizes);
+
+    row->fields = NULL;
+    row->fields_count = 0;
+    row->lengths = NULL;
+    row->__fields_capacity = 0;
+    row->__field_sizes = NULL;
+  }
+
+  int ccsv_next_batch(ccsv_reader *reader, int max_rows, ccsv_batch *batch)
+  {
+    if (reader == NULL)
+      return CCSV_ERINVALID;
+
+    if (batch == NULL || max_rows <= 0)
+    {
+      reader->status = CCSV_ERINVALID;
+      return CCSV_ERINVALID;
+    }
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    if (max_rows > batch->__rows_capacity)
+    {
+      int *fields_counts = (int *)realloc(batch->fields_counts, sizeof(int) * max_rows);
+      if (fields_counts == NULL)
+      {
+        reader->status = CCSV_ERNOMEM;
+        return CCSV_ERNOMEM;
+      }
+      batch->fields_counts = fields_counts;
+      batch->__rows_capacity = max_rows;
+    }
+
+    /* Offset 0 holds an empty field for the cells of short rows */
+    batch->rows_count = 0;
+    batch->columns = 0;
+    batch->__data_size = 1;
+    if (_grow_batch(batch, 0, 0) != CCSV_SUCCESS)
+    {
+      reader->status = CCSV_ERNOMEM;
+      return CCSV_ERNOMEM;
+    }
+    batch->data[0] = CCSV_NULL_CHAR;
+
+    while (batch->rows_count < max_rows)
+    {
+      const int fields_count = _parse_row(reader);
+      if (fields_count <= 0)
+      {
+        /* Rows read before the end or an error are still returned */
+        if (batch->rows_count > 0 && fields_count != CCSV_ERNOMEM)
+          break;
+        return fields_count;
+      }
+
+      const ccsv_field_view *views = reader->__row_view.fields;
+      size_t data_size = 0;
+      for (int i = 0; i < fields_count; i++)
+        data_size += views[i].len + 1;
+
+      if (_grow_batch(batch, fields_count, data_size) != CCSV_SUCCESS)
+      {
+        reader->status = CCSV_ERNOMEM;
+        return CCSV_ERNOMEM;
+      }
+
+      const int columns = batch->columns;
+      size_t *offsets = batch->offsets + (size_t)batch->rows_count * columns;
+      size_t *lengths = batch->lengths + (size_t)batch->rows_count * columns;
+      char *data = batch->data;
+      size_t data_pos = batch->__data_size;
+      for (int i = 0; i < fields_count; i++)
+      {
+        const size_t len = views[i].len;
+        memcpy(data + data_pos, views[i].data, len);
+        data[data_pos + len] = CCSV_NULL_CHAR;
+        offsets[i] = data_pos;
+        lengths[i] = len;
+        data_pos += len + 1;
+      }
+      for (int i = fields_count; i < columns; i++)
+      {
+        offsets[i] = 0;
+        lengths[i] = 0;
+      }
+
+      batch->__data_size = data_pos;
+      batch->fields_counts[batch->rows_count++] = fields_count;
+    }
+
+    return batch->rows_count;
+  }
+
+  int _grow_batch(ccsv_batch *batch, int fields_count, size_t data_size)
+  {
+    const size_t needed_data = batch->__data_size + data_size;
+    if (needed_data > batch->__data_capacity)
+    {
+      size_t capacity = batch->__data_capacity * 2;
+      if (capacity < needed_data)
+        capacity = needed_data < CCSV_BUFFER_SIZE ? CCSV_BUFFER_SIZE : needed_data;
+      char *data = (char *)realloc(batch->data, capacity);
+      if (data == NULL)
+        return CCSV_ERNOMEM;
+      batch->data = data;
+      batch->__data_capacity = capacity;
+    }
+
+    const int old_columns = batch->columns;
+    const int columns = fields_count > old_columns ? fields_count : old_columns;
+    const size_t needed_cells = (size_t)(batch->rows_count + 1) * columns;
+    if (needed_cells > batch->__cells_capacity)
+    {
+      size_t capacity = batch->__cells_capacity * 2;
+      if (capacity < needed_cells)
+        capacity = needed_cells;
+      size_t *offsets = (size_t *)realloc(batch->offsets, sizeof(size_t) * capacity);
+      if (offsets == NULL)
+        return CCSV_ERNOMEM;
+      batch->offsets = offsets;
+      size_t *lengths = (size_t *)realloc(batch->lengths, sizeof(size_t) * capacity);
+      if (lengths == NULL)
+        return CCSV_ERNOMEM;
+      batch->lengths = lengths;
+      batch->__cells_capacity = capacity;
+    }
+
+    if (columns > old_columns)
+    {
+      /* Spread the rows read so far to the new width, from the last one so none is overwritten */
+      size_t *offsets = batch->offsets;
+      size_t *lengths = batch->lengths;
+      for (int row = batch->rows_count - 1; row >= 0; row--)
+      {
+        for (int i = columns - 1; i >= 0; i--)
+        {
+          const size_t cell = (size_t)row * columns + i;
+          if (i < old_columns)
+          {
+            offsets[cell] = offsets[(size_t)row * old_columns + i];
+            lengths[cell] = lengths[(size_t)row * old_columns + i];
+          }
+          else
+          {
+            offsets[cell] = 0;
+            lengths[cell] = 0;
+          }
+        }
+      }
+      batch->columns = columns;
+    }
+
+    return CCSV_SUCCESS;
+  }
+
+  void ccsv_clear_batch(ccsv_batch *batch)
+  {
+    if (batch == NULL)
+      return;
+
+    _free_multiple(4, batch->data, batch->offsets, batch->lengths, batch->fields_counts);
+
+    batch->data = NULL;
+    batch->offsets = NULL;
+    batch->lengths = NULL;
+    batch->fields_counts = NULL;
+    batch->rows_count = 0;
+    batch->columns = 0;
+    batch->__data_size = 0;
+    batch->__data_capacity = 0;
+    batch->__cells_capacity = 0;
+    batch->__rows_capacity = 0;
+  }
+
+  ccsv_row *_next(ccsv_reader *reader)
+  {
+    const int fields_count = _parse_row(reader);
+    if (fields_count <= 0)
+      return NULL;
+
+    const ccsv_field_view *views = reader->__row_view.fields;
+
+    if (reader->__use_arena)
+      return _next_from_arena(reader, views, fields_count);
+
+    ccsv_row *row = (ccsv_row *)malloc(sizeof(ccsv_row));
+    if (row == NULL)
+    {
+      reader->status = CCSV_ERNOMEM;
+      return NULL;
+    }
+
+    /* Lengths share the allocation of the fields array */
+    char **fields = (char **)malloc((sizeof(char *) + sizeof(size_t)) * fields_count);
+    if (fields == NULL)
+    {
+      free(row);
+      reader->status = CCSV_ERNOMEM;
+      return NULL;
+    }
+    size_t *lengths = (size_t *)(fields + fields_count);
+
+    for (int i = 0; i < fields_count; i++)
+    {
+      char *field = (char *)malloc(views[i].len + 1);
+      if (field == NULL)
+      {
+        row->fields = fields;
+        row->fields_count = i;
+        row->__arena = NULL;
+        ccsv_free_row(row);
+        reader->status = CCSV_ERNOMEM;
+        return NULL;
+      }
+
+      /* Views over a mapped file are not NUL terminated */
+      memcpy(field, views[i].data, views[i].len);
+      field[views[i].len] = CCSV_NULL_CHAR;
+      fields[i] = field;
+      lengths[i] = views[i].len;
+    }
+
+    row->fields = fields;
+    row->fields_count = fields_count;
+    row->lengths = lengths;
+    row->ascii = reader->__row_view.ascii;
+    row->__arena = NULL;
+    row->__fields_capacity = 0;
+    row->__field_sizes = NULL;
+    return row;
+  }
+
+  ccsv_row *_next_from_arena(ccsv_reader *reader, const ccsv_field_view *views, int fields_count)
+  {
+    /* Row, fields array, lengths and field bytes are laid out in a single block */
+    size_t size = sizeof(ccsv_row) + (sizeof(char *) + sizeof(size_t)) * fields_count;
+    for (int i = 0; i < fields_count; i++)
+      size += views[i].len + 1;
+
+    char *block = (char *)_arena_alloc(&reader->__arena, size);
+    if (block == NULL)
+    {
+      reader->status = CCSV_ERNOMEM;
+      return NULL;
+    }
+
+    ccsv_row *row = (ccsv_row *)block;
+    char **fields = (char **)(block + sizeof(ccsv_row));
+    size_t *lengths = (size_t *)(fields + fields_count);
+    char *field = (char *)(lengths + fields_count);
+
+    for (int i = 0; i < fields_count; i++)
+    {
+      memcpy(field, views[i].data, views[i].len);
+      field[views[i].len] = CCSV_NULL_CHAR;
+      fields[i] = field;
+      lengths[i] = views[i].len;
+      field += views[i].len + 1;
+    }
+
+    row->fields = fields;
+    row->fields_count = fields_count;
+    row->lengths = lengths;
+    row->ascii = reader->__row_view.ascii;
+    row->__arena = &reader->__arena;
+    row->__fields_capacity = 0;
+    row->__field_sizes = NULL;
+    reader->__arena.live_rows++;
+    return row;
+  }
+
+  int _parse_row(ccsv_reader *reader)
+  {
+#ifdef CCSV_STATS
+    /* Reading the clock costs as much as parsing a short row, only some rows are timed */
+    const bool timed = reader->__stats.rows % CCSV_STATS_SAMPLE == 0;
+    const uint64_t started = timed ? _stats_clock() : 0;
+    const uint64_t io_ns = reader->__stats.io_ns;
+#endif
+
+    int fields_count = _parse_record(reader);
+    if (fields_count > 0 && reader->__usecols_count > 0)
+      fields_count = _project_row(reader, fields_count);
+
+    /* Fields are only looked at if the buffer holds bytes above 0x7f */
+    if (fields_count > 0 && reader->__validate_utf8)
+      reader->__row_view.ascii = reader->__buffer_ascii || _fields_ascii(reader->__row_view.fields, fields_count);
+
+#ifdef CCSV_STATS
+    if (fields_count > 0)
+      _stats_row(reader, fields_count);
+    /* Refills while parsing the row are counted as I/O */
+    if (timed)
+      reader->__stats.parse_ns += (_stats_clock() - started - (reader->__stats.io_ns - io_ns)) * CCSV_STATS_SAMPLE;
+#endif
+    return fields_count;
+  }
+
+  int _project_row(ccsv_reader *reader, int fields_count)
+  {
+    if (reader->__usecols_names != NULL && _resolve_usecols(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    const ccsv_field_view *fields = reader->__row_view.fields;
+    ccsv_field_view *projected = reader->__projected;
+    const int *usecols = reader->__usecols;
+    const int usecols_count = reader->__usecols_count;
+
+    for (int i = 0; i < usecols_count; i++)
+    {
+      if (usecols[i] < fields_count)
+        projected[i] = fields[usecols[i]];
+      else
+      {
+        /* Column missing from a short record */
+        projected[i].data = "";
+        projected[i].len = 0;
+      }
+    }
+
+    reader->__row_view.fields = projected;
+    reader->__row_view.fields_count = usecols_count;
+    return usecols_count;
+  }
+
+  int _resolve_usecols(ccsv_reader *reader)
+  {
+    const ccsv_field_view *fields = reader->__row_view.fields;
+    const int fields_count = reader->__row_view.fields_count;
+
+    for (int i = 0; i < reader->__usecols_count; i++)
+    {
+      const char *name = reader->__usecols_names[i];
+      const size_t name_len = strlen(name);
+
+      int column = 0;
+      if (reader->__header != NULL)
+        column = _header_lookup(reader->__header, name, name_len);
+      else
+      {
+        while (column < fields_count &&
+               (fields[column].len != name_len || memcmp(fields[column].data, name, name_len) != 0))
+          column++;
+        if (column == fields_count)
+          column = -1;
+      }
+
+      if (column < 0)
+      {
+        /* Name not in the header */
+        reader->status = CCSV_ERINVALID;
+        return CCSV_ERINVALID;
+      }
+      reader->__usecols[i] = column;
+    }
+
+    free(reader->__usecols_names);
+    reader->__usecols_names = NULL;
+    return _mark_used_columns(reader);
+  }
+
+  int _mark_used_columns(ccsv_reader *reader)
+  {
+    int used_count = 0;
+    for (int i = 0; i < reader->__usecols_count; i++)
+      if (reader->__usecols[i] >= used_count)
+        used_count = reader->__usecols[i] + 1;
+
+    unsigned char *used = (unsigned char *)calloc(used_count, sizeof(unsigned char));
+    if (used == NULL)
+    {
+      reader->status = CCSV_ERNOMEM;
+      return CCSV_ERNOMEM;
+    }
+    for (int i = 0; i < reader->__usecols_count; i++)
+      used[reader->__usecols[i]] = 1;
+
+    reader->__column_used = used;
+    reader->__column_used_count = used_count;
+    return CCSV_SUCCESS;
+  }
+
+  int _parse_record(ccsv_reader *reader)
+  {
+    if (reader->__header_pending)
+    {
+      const int header_status = _read_header(reader);
+      if (header_status <= 0)
+        return header_status;
+    }
+
+    if (reader->__parallel != NULL)
+      return _parse_row_parallel(reader);
+
+    /* A partial record the state machine stopped in is resumed by it */
+    if (reader->__index.enabled && !reader->__resume.pending)
+    {
+      const int indexed_fields = _parse_row_indexed(reader);
+      if (indexed_fields != CCSV_INDEX_FALLBACK)
+        return indexed_fields;
+    }
+
+    /* Fields are unescaped in place, a mapping has to be mapped again before it is read twice */
+    if (reader->__mapped)
+      reader->__map_dirty = true;
+
+    const char DELIM = reader->__delim;
+    const char QUOTE_CHAR = reader->__quote_char;
+    const char COMMENT_CHAR = reader->__comment_char;
+    const char ESCAPE_CHAR = reader->__escape_char;
+    const int SKIP_INITIAL_SPACE = reader->__skip_initial_space;
+    const int SKIP_EMPTY_LINES = reader->__skip_empty_lines;
+    const int SKIP_COMMENTS = reader->__skip_comments;
+
+    State state = FIELD_START;
+
+    char *buffer = reader->__buffer;
+    size_t buffer_size = reader->__buffer_size;
+    size_t row_pos = reader->__buffer_pos;
+
+    /*
+     * Fields are unescaped in place: field_pos (write position) never
+     * gets ahead of row_pos (read position), so the bytes of the current
+     * record can be rewritten without a second buffer.
+     */
+    size_t row_start = row_pos;
+    size_t field_start = row_pos;
+    size_t field_pos = row_pos;
+    int fields_count = 0;
+
+    bool skip_lf = reader->__skip_lf;
+    char c = CCSV_NULL_CHAR;
+
+    if (reader->__resume.pending)
+    {
+      /* More bytes were fed to a push reader, go on from where it ran out */
+      const ccsv_parse_state *resume = &reader->__resume;
+      state = resume->state;
+      row_pos = resume->row_pos;
+      field_start = resume->field_start;
+      field_pos = resume->field_pos;
+      fields_count = resume->fields_count;
+      c = resume->c;
+      reader->__resume.pending = false;
+    }
+
+    /* Bytes that end a plain run in unquoted and quoted fields */
+    const char FIELD_SPECIALS[4] = {DELIM, CCSV_CR, CCSV_LF, DELIM};
+    const char QUOTED_SPECIALS[4] = {QUOTE_CHAR, ESCAPE_CHAR, QUOTE_CHAR, ESCAPE_CHAR};
+
+    for (;;)
+    {
+      if (row_pos >= buffer_size)
+      {
+        if (!reader->__eof)
+        {
+          /* Keep the partial record, move it to the front and read more */
+          const size_t shift = row_start;
+          const int fill_status = _fill_buffer(reader, row_start);
+
+          buffer = reader->__buffer;
+          buffer_size = reader->__buffer_size;
+          row_pos -= shift;
+          field_start -= shift;
+          field_pos -= shift;
+          row_start = 0;
+          for (int i = 0; i < fields_count; i++)
+            reader->__field_starts[i] -= shift;
+
+          if (fill_status != CCSV_SUCCESS)
+          {
+            reader->__skip_lf = skip_lf;
+            if (fill_status == CCSV_ERAGAIN)
+            {
+              /* The partial record is kept at the front of the buffer until more bytes are fed */
+              ccsv_parse_state *resume = &reader->__resume;
+              resume->state = state;
+              resume->row_pos = row_pos;
+              resume->field_start = field_start;
+              resume->field_pos = field_pos;
+              resume->fields_count = fields_count;
+              resume->c = c;
+              resume->pending = true;
+            }
+            return reader->status;
+          }
+          continue;
+        }
+
+        if (fields_count == 0 &&
+            (state == FIELD_START || state == FIELD_NOT_STARTED || state == INSIDE_COMMENT))
+        {
+          /* Nothing pending, all rows are read */
+          reader->__buffer_pos = row_pos;
+          reader->status = CCSV_SUCCESS;
+          return 0;
+        }
+
+        /* Last record of the file is not terminated */
+        c = CCSV_NULL_CHAR;
+        END_ROW();
+      }
+
+      c = buffer[row_pos++];
+
+      if (skip_lf)
+      {
+        /* Previous line ended with CR, this LF is part of CRLF */
+        skip_lf = false;
+        if (c == CCSV_LF)
+        {
+          row_start = field_start = field_pos = row_pos;
+          continue;
+        }
+      }
+
+      switch (state)
+      {
+      case FIELD_START:
+        if (SKIP_COMMENTS && fields_count == 0 && c == COMMENT_CHAR)
+          state = INSIDE_COMMENT; /* Do not return comment lines */
+        else if (c == QUOTE_CHAR)
+        {
+          state = INSIDE_QUOTED_FIELD; /* Start of quoted field */
+          field_start = field_pos = row_pos;
+          COPY_RUN(QUOTED_SPECIALS);
+        }
+        else if (SKIP_INITIAL_SPACE && c == CCSV_SPACE)
+        {
+          state = FIELD_NOT_STARTED; /* Skip initial spaces */
+          field_start = field_pos = row_pos;
+        }
+        else if (c == DELIM)
+          END_FIELD(); /* Empty field */
+        else if (IS_TERMINATOR(c))
+        {
+          if (SKIP_EMPTY_LINES && fields_count == 0)
+            SKIP_LINE(); /* Do not return empty lines */
+          else
+            END_ROW();
+        }
+        else
+        {
+          state = FIELD_STARTED;
+          buffer[field_pos++] = c;
+          COPY_RUN(FIELD_SPECIALS);
+        }
+        break;
+
+      case INSIDE_QUOTED_FIELD:
+        if (c == QUOTE_CHAR)
+          state = MAY_BE_ESCAPED; /* Might be the end of the field, or it might be a escaped quote */
+        else if (c == ESCAPE_CHAR)
+          state = ESCAPED_CHAR; /* Next character is taken as is */
+        else
+        {
+          buffer[field_pos++] = c;
+          COPY_RUN(QUOTED_SPECIALS);
+        }
+        break;
+
+      case ESCAPED_CHAR:
+        state = INSIDE_QUOTED_FIELD;
+        buffer[field_pos++] = c;
+        break;
+
+      case MAY_BE_ESCAPED:
+        if (c == QUOTE_CHAR)
+        {
+          state = INSIDE_QUOTED_FIELD; /* Escaped quote */
+          buffer[field_pos++] = c;
+        }
+        else if (c == DELIM)
+          END_FIELD(); /* End of field */
+        else if (IS_TERMINATOR(c))
+          END_ROW(); /* End of field and row */
+        else
+        {
+          state = FIELD_STARTED;
+          buffer[field_pos++] = c;
+        }
+        break;
+
+      case FIELD_NOT_STARTED:
+        if (c == CCSV_SPACE)
+        {
+          /* Skip initial spaces, will only get to this point if skip_initial_spaces = 1 */
+          field_start = field_pos = row_pos;
+          break;
+        }
+
+        if (SKIP_COMMENTS && fields_count == 0 && c == COMMENT_CHAR)
+          state = INSIDE_COMMENT;
+        else if (c == QUOTE_CHAR)
+        {
+          state = INSIDE_QUOTED_FIELD; /* Start of quoted field */
+          field_start = field_pos = row_pos;
+          COPY_RUN(QUOTED_SPECIALS);
+        }
+        else if (c == DELIM)
+          END_FIELD(); /* Return empty field */
+        else if (IS_TERMINATOR(c))
+          END_ROW();
+        else
+        {
+          state = FIELD_STARTED;
+          buffer[field_pos++] = c; /* Start of non-quoted field */
+          COPY_RUN(FIELD_SPECIALS);
+        }
+        break;
+
+      case FIELD_STARTED:
+        if (c == DELIM)
+          END_FIELD(); /* End of field */
+        else if (IS_TERMINATOR(c))
+          END_ROW(); /* End of field and row */
+        else
+        {
+          buffer[field_pos++] = c; /* Add the character to the field */
+          COPY_RUN(FIELD_SPECIALS);
+        }
+        break;
+
+      case INSIDE_COMMENT:
+        if (IS_TERMINATOR(c))
+          SKIP_LINE();
+        break;
+
+      default:
+        break;
+      }
+    }
+
+  end:
+    for (int i = 0; i < fields_count; i++)
+      reader->__fields[i].data = buffer + reader->__field_starts[i];
+
+    reader->__row_view.fields = reader->__fields;
+    reader->__row_view.fields_count = fields_count;
+
+    reader->__buffer_pos = row_pos;
+    reader->__skip_lf = c == CCSV_CR;
+
+    reader->rows_read++;
+    reader->status = CCSV_SUCCESS;
+    return fields_count;
+  }
+
+  int _map_file(ccsv_reader *reader, FILE *fp)
+  {
+#ifdef CCSV_MMAP
+    const int fd = fileno(fp);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+      return CCSV_ERROR; /* Pipes and empty files are read through the buffer */
+
+    const size_t file_size = (size_t)st.st_size;
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    /*
+     * Reserve room for the file and at least one more byte, then map the
+     * file over it. Bytes past the end of the file read as zero, so the
+     * buffer keeps its NUL sentinel without writing to the mapping.
+     */
+    const size_t map_size = (file_size / page_size + 1) * page_size;
+    char *reserved = (char *)mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED)
+      return CCSV_ERROR;
+
+    char *mapped = (char *)mmap(reserved, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+      munmap(reserved, map_size);
+      return CCSV_ERROR;
+    }
+
+    posix_madvise(mapped, file_size, POSIX_MADV_SEQUENTIAL);
+    posix_madvise(mapped, file_size, POSIX_MADV_WILLNEED);
+
+    reader->__buffer = mapped;
+    reader->__buffer_pos = 0;
+    reader->__buffer_size = file_size;
+    reader->__buffer_capacity = file_size;
+    reader->__file_pos = file_size;
+    reader->__eof = true;
+    reader->__mapped = true;
+    reader->__map_dirty = false;
+    reader->__map_size = map_size;
+    return CCSV_SUCCESS;
+#else
+    (void)reader;
+    (void)fp;
+    return CCSV_ERROR;
+#endif
+  }
+
+  int _fill_buffer(ccsv_reader *reader, size_t keep_from)
+  {
+    if (reader->__utf8_invalid)
+    {
+      reader->status = CCSV_ERUTF8;
+      return CCSV_ERUTF8;
+    }
+
+    char *buffer = reader->__buffer;
+    const size_t keep = reader->__buffer_size - keep_from;
+    const bool at_start = keep == 0 && reader->__file_pos == 0;
+
+    if (keep_from > 0)
+    {
+      memmove(buffer, buffer + keep_from, keep);
+      if (reader->__validate_utf8)
+      {
+        /* Only a cut sequence at the end of the kept bytes is left to validate */
+        reader->__utf8_checked = reader->__utf8_checked > keep_from ? reader->__utf8_checked - keep_from : 0;
+        if (!reader->__buffer_ascii)
+          reader->__buffer_ascii = _utf8_is_ascii((const unsigned char *)buffer, keep);
+      }
+    }
+    else if (keep == reader->__buffer_capacity)
+    {
+      /* A single record fills the whole buffer, make room for the rest of it */
+      size_t capacity = reader->__buffer_capacity * 2;
+      char *temp = (char *)realloc(buffer, capacity + 1);
+      if (temp == NULL)
+      {
+        reader->status = CCSV_ERNOMEM;
+        return CCSV_ERNOMEM;
+      }
+      buffer = temp;
+      reader->__buffer = buffer;
+      reader->__buffer_capacity = capacity;
+      CCSV_STAT_ADD(reader, buffer_grows, 1);
+    }
+
+#ifdef CCSV_STATS
+    const uint64_t read_started = _stats_clock();
+#endif
+    const size_t free_space = reader->__buffer_capacity - keep;
+    size_t bytes_read;
+    if (reader->__push)
+      bytes_read = 0; /* Bytes are only added by ccsv_feed() */
+    else if (reader->__read_ahead != NULL)
+      bytes_read = _read_ahead(reader, buffer + keep, free_space);
+    else
+      bytes_read = _read_source(reader->__fp, reader->__decoder, buffer + keep, free_space);
+    if (bytes_read == 0 && reader->__follow > 0)
+      bytes_read = _follow_read(reader, buffer + keep, free_space, keep == 0);
+    reader->__file_pos += bytes_read;
+#ifdef CCSV_STATS
+    reader->__stats.io_ns += _stats_clock() - read_started;
+#endif
+    CCSV_STAT_ADD(reader, bytes_read, bytes_read);
+    CCSV_STAT_ADD(reader, refills, bytes_read > 0);
+
+    reader->__buffer_size = keep + bytes_read;
+    reader->__buffer_pos = 0;
+
+    if (reader->__validate_utf8)
+    {
+      /* Bytes of the BOM stay counted in __file_pos, so offsets still match the file */
+      if (at_start && reader->__buffer_size >= sizeof(UTF8_BOM) && memcmp(buffer, UTF8_BOM, sizeof(UTF8_BOM)) == 0)
+      {
+        reader->__buffer_size -= sizeof(UTF8_BOM);
+        memmove(buffer, buffer + sizeof(UTF8_BOM), reader->__buffer_size);
+      }
+      if (keep == 0)
+      {
+        reader->__utf8_checked = 0;
+        reader->__buffer_ascii = true;
+      }
+    }
+    buffer[reader->__buffer_size] = CCSV_NULL_CHAR;
+
+    if (bytes_read == 0 && reader->__follow == 0 && !reader->__push)
+      reader->__eof = true;
+
+    _index_invalidate(reader);
+
+    if (reader->__validate_utf8 && _utf8_check_buffer(reader, reader->__eof) != CCSV_SUCCESS)
+    {
+      /* Drop the bytes read, so no row holding them is returned by a later call */
+      reader->__buffer_size = keep;
+      buffer[keep] = CCSV_NULL_CHAR;
+      reader->__eof = false;
+      return CCSV_ERUTF8;
+    }
+
+    if (bytes_read == 0 && reader->__decoder != NULL && _decoder_failed(reader->__decoder))
+    {
+      reader->status = CCSV_ERDECODE;
+      return CCSV_ERDECODE;
+    }
+
+    if (bytes_read == 0 && reader->__follow > 0)
+    {
+      /* Followed file did not grow in time, the next call waits again */
+      reader->status = CCSV_ERTIMEOUT;
+      return CCSV_ERTIMEOUT;
+    }
+
+    if (bytes_read == 0 && reader->__push)
+    {
+      reader->status = CCSV_ERAGAIN;
+      return CCSV_ERAGAIN;
+    }
+
+    return CCSV_SUCCESS;
+  }
+
+  int _utf8_check_buffer(ccsv_reader *reader, bool final)
+  {
+    const unsigned char *buffer = (const unsigned char *)reader->__buffer;
+    const size_t start = reader->__utf8_checked;
+    const size_t end = final ? reader->__buffer_size : _utf8_complete_end(buffer, start, reader->__buffer_size);
+
+    bool ascii = true;
+    if (!_utf8_validate(buffer + start, end - start, &ascii))
+    {
+      /* The row holding the bytes is never returned, nor any after it */
+      reader->__utf8_invalid = true;
+      reader->status = CCSV_ERUTF8;
+      return CCSV_ERUTF8;
+    }
+
+    /* A cut sequence left for later is not ASCII either */
+    reader->__buffer_ascii = reader->__buffer_ascii && ascii && end == reader->__buffer_size;
+    reader->__utf8_checked = end;
+    return CCSV_SUCCESS;
+  }
+
+  int _utf8_check_mapping(ccsv_reader *reader)
+  {
+    if (!reader->__validate_utf8)
+      return CCSV_SUCCESS;
+
+    const unsigned char *buffer = (const unsigned char *)reader->__buffer;
+    const size_t size = reader->__buffer_size;
+    bool ascii = true;
+    if (!_utf8_validate(buffer, size, &ascii))
+    {
+#ifdef CCSV_MMAP
+      /* Read through the buffer instead, the rows before the invalid bytes are still returned */
+      munmap(reader->__buffer, reader->__map_size);
+#endif
+      reader->__buffer = NULL;
+      reader->__buffer_size = 0;
+      reader->__buffer_capacity = 0;
+      reader->__file_pos = 0;
+      reader->__eof = false;
+      reader->__mapped = false;
+      reader->__map_size = 0;
+      return CCSV_ERUTF8;
+    }
+
+    reader->__buffer_ascii = ascii;
+    reader->__utf8_checked = size;
+    if (size >= sizeof(UTF8_BOM) && memcmp(buffer, UTF8_BOM, sizeof(UTF8_BOM)) == 0)
+      reader->__bom_size = sizeof(UTF8_BOM);
+    reader->__buffer_pos = reader->__bom_size;
+    return CCSV_SUCCESS;
+  }
+
+  void _index_invalidate(ccsv_reader *reader)
+  {
+    /* Offsets in the index are no longer valid */
+    ccsv_index *index = &reader->__index;
+    index->stale = true;
+    index->irregular_end = 0;
+    if (index->fallback_fills > 0)
+    {
+      /* Quoting did not suit the index recently, parse this buffer with the state machine */
+      index->fallback_fills--;
+      index->irregular_end = reader->__buffer_size;
+    }
+  }
+
+  void _index_reset(ccsv_reader *reader, size_t from)
+  {
+    ccsv_index *index = &reader->__index;
+    index->count = 0;
+    index->cursor = 0;
+    index->base = from;
+    index->end = from;
+    index->in_quotes = 0;
+    index->prev_boundary = 1; /* Indexing always starts at a record boundary */
+    index->pending_close = 0;
+    index->pending_escape = 0;
+    index->irregular_end = 0;
+    index->stale = false;
+  }
+
+  int _index_build(ccsv_reader *reader)
+  {
+    ccsv_index *index = &reader->__index;
+
+    if (index->positions == NULL)
+    {
+      index->positions = (uint32_t *)malloc(sizeof(uint32_t) * CCSV_INDEX_WINDOW);
+      if (index->positions == NULL)
+      {
+        reader->status = CCSV_ERNOMEM;
+        return CCSV_ERNOMEM;
+      }
+    }
+
+    const size_t start = index->end;
+    const size_t end = reader->__buffer_size - start > CCSV_INDEX_WINDOW
+                           ? start + CCSV_INDEX_WINDOW
+                           : reader->__buffer_size;
+
+    index->count = 0;
+    index->cursor = 0;
+    index->base = start;
+    index->end = end;
+
+    if (CCSV_KERNEL(_index_kernel)(index, reader->__buffer, start, end, reader->__delim, reader->__quote_char))
+    {
+      /* Back off for more buffer fills each time in a row, so irregular files are not indexed twice */
+      index->backoff = index->backoff > 0 ? index->backoff * 2 : 1;
+      if (index->backoff > CCSV_INDEX_MAX_BACKOFF)
+        index->backoff = CCSV_INDEX_MAX_BACKOFF;
+      index->fallback_fills = index->backoff;
+      index->irregular_end = end;
+      index->stale = true;
+      return CCSV_INDEX_FALLBACK;
+    }
+
+    index->backoff = 0;
+    return CCSV_SUCCESS;
+  }
+
+  int _index_next_record(ccsv_reader *reader, size_t *row_start)
+  {
+    ccsv_index *index = &reader->__index;
+    const char DELIM = reader->__delim;
+    const int SKIP_EMPTY_LINES = reader->__skip_empty_lines;
+
+    if (index->irregular_end > 0)
+    {
+      if (reader->__buffer_pos < index->irregular_end)
+        return CCSV_INDEX_FALLBACK;
+      index->stale = true;
+    }
+
+    if (index->stale)
+      _index_reset(reader, reader->__buffer_pos);
+
+    size_t start = reader->__buffer_pos;
+    bool skip_lf = reader->__skip_lf;
+    int fields_count = 0;
+
+    for (;;)
+    {
+      if (index->cursor == index->count)
+      {
+        if (index->end < reader->__buffer_size)
+        {
+          const int build_status = _index_build(reader);
+          if (build_status != CCSV_SUCCESS)
+            return build_status;
+          continue;
+        }
+
+        if (!reader->__eof)
+        {
+          /* Skipped lines are consumed, the partial record is kept and re-indexed */
+          reader->__buffer_pos = start;
+          reader->__skip_lf = skip_lf;
+          if (_fill_buffer(reader, start) != CCSV_SUCCESS)
+            return reader->status;
+
+          reader->__buffer_pos = start = 0;
+          fields_count = 0;
+          _index_reset(reader, 0);
+          continue;
+        }
+
+        if (index->in_quotes)
+        {
+          /* Unterminated quoted field at the end of the file */
+          index->stale = true;
+          return CCSV_INDEX_FALLBACK;
+        }
+
+        if (fields_count == 0 && start >= reader->__buffer_size)
+        {
+          reader->__buffer_pos = start;
+          reader->__skip_lf = skip_lf;
+          reader->status = CCSV_SUCCESS;
+          return 0;
+        }
+
+        /* Last record of the file is not terminated */
+        if (fields_count == reader->__fields_capacity &&
+            _grow_fields(reader, fields_count + 1) != CCSV_SUCCESS)
+          return CCSV_ERNOMEM;
+        reader->__field_starts[fields_count++] = reader->__buffer_size |
+                                                 (index->pending_escape ? CCSV_FIELD_ESCAPED : 0);
+        break;
+      }
+
+      const uint32_t entry = index->positions[index->cursor++];
+      const size_t pos = index->base + (entry & ~CCSV_INDEX_ESCAPED);
+      const char c = reader->__buffer[pos];
+
+      if (skip_lf)
+      {
+        /* Previous line ended with CR, this LF is part of CRLF */
+        skip_lf = false;
+        if (pos == start && c == CCSV_LF)
+        {
+          start++;
+          continue;
+        }
+      }
+
+      if (fields_count == reader->__fields_capacity &&
+          _grow_fields(reader, fields_count + 1) != CCSV_SUCCESS)
+        return CCSV_ERNOMEM;
+      reader->__field_starts[fields_count++] = pos | (entry & CCSV_INDEX_ESCAPED ? CCSV_FIELD_ESCAPED : 0);
+
+      if (c == DELIM)
+        continue;
+
+      if (SKIP_EMPTY_LINES && fields_count == 1 && pos == start)
+      {
+        /* Do not return empty lines */
+        CCSV_STAT_ADD(reader, lines_skipped, 1);
+        skip_lf = c == CCSV_CR;
+        start = pos + 1;
+        fields_count = 0;
+        continue;
+      }
+      break;
+    }
+
+    *row_start = start;
+    return fields_count;
+  }
+
+  int _parse_row_indexed(ccsv_reader *reader)
+  {
+    size_t row_start = 0;
+    const int fields_count = _index_next_record(reader, &row_start);
+    if (fields_count <= 0 || fields_count == CCSV_INDEX_FALLBACK)
+      return fields_count;
+
+    return _index_emit_record(reader, row_start, fields_count);
+  }
+
+  void _index_skip_record(ccsv_reader *reader, int fields_count)
+  {
+    const size_t row_end = reader->__field_starts[fields_count - 1] & ~CCSV_FIELD_ESCAPED;
+    if (row_end < reader->__buffer_size)
+    {
+      reader->__skip_lf = reader->__buffer[row_end] == CCSV_CR;
+      reader->__buffer_pos = row_end + 1;
+    }
+    else
+    {
+      reader->__skip_lf = false;
+      reader->__buffer_pos = row_end;
+    }
+
+    reader->rows_read++;
+    reader->status = CCSV_SUCCESS;
+  }
+
+  int _index_emit_record(ccsv_reader *reader, size_t row_start, int fields_count)
+  {
+    const char QUOTE_CHAR = reader->__quote_char;
+    const bool MAPPED = reader->__mapped;
+    const unsigned char *column_used = reader->__column_used;
+    const int column_used_count = reader->__column_used_count;
+    char *buffer = reader->__buffer;
+    ccsv_field_view *views = reader->__fields;
+
+    /* __field_starts holds the offset of the byte ending each field, flagged if it has escaped quotes */
+    const size_t *field_ends = reader->__field_starts;
+    const size_t row_end = field_ends[fields_count - 1] & ~CCSV_FIELD_ESCAPED;
+    const char terminator = row_end < reader->__buffer_size ? buffer[row_end] : CCSV_NULL_CHAR;
+
+    /*
+     * A mapped file is not written to, every write would copy a page.
+     * Unescaped fields go to the scratch buffer, which fits the whole record.
+     */
+    char *scratch = reader->__scratch;
+    if (MAPPED && row_end - row_start + 1 > reader->__scratch_capacity)
+    {
+      if (_grow_scratch(reader, row_end - row_start + 1) != CCSV_SUCCESS)
+        return CCSV_ERNOMEM;
+      scratch = reader->__scratch;
+    }
+
+    size_t field_start = row_start;
+    for (int i = 0; i < fields_count; i++)
+    {
+      const size_t field_end = field_ends[i] & ~CCSV_FIELD_ESCAPED;
+      char *field = buffer + field_start;
+      size_t len = field_end - field_start;
+
+      if (len > 0 && *field == QUOTE_CHAR)
+      {
+        /* The index only accepts quoted fields that end with the closing quote */
+        field++;
+        len -= 2;
+
+        /* Columns left out by usecols are never unescaped */
+        if ((field_ends[i] & CCSV_FIELD_ESCAPED) &&
+            (column_used == NULL || (i < column_used_count && column_used[i])))
+        {
+          /* Collapse escaped quotes, moving the runs between them */
+          const char *src = field;
+          const char *src_end = field + len;
+          char *dst = MAPPED ? scratch : field;
+          char *unescaped = dst;
+          const char *quote;
+          while ((quote = (const char *)memchr(src, QUOTE_CHAR, src_end - src)) != NULL)
+          {
+            const size_t run = quote - src + 1;
+            if (dst != src)
+              memmove(dst, src, run);
+            dst += run;
+            src = quote + 2;
+          }
+          if (dst != src)
+            memmove(dst, src, src_end - src);
+          dst += src_end - src;
+
+          field = unescaped;
+          len = dst - unescaped;
+          if (MAPPED)
+          {
+            *dst = CCSV_NULL_CHAR;
+            scratch = dst + 1;
+          }
+        }
+      }
+
+      if (!MAPPED)
+        field[len] = CCSV_NULL_CHAR;
+      views[i].data = field;
+      views[i].len = len;
+      field_start = field_end + 1;
+    }
+
+    reader->__row_view.fields = views;
+    reader->__row_view.fields_count = fields_count;
+
+    reader->__buffer_pos = row_end < reader->__buffer_size ? row_end + 1 : row_end;
+    reader->__skip_lf = terminator == CCSV_CR;
+
+    reader->rows_read++;
+    reader->status = CCSV_SUCCESS;
+    return fields_count;
+  }
+
+  int _grow_scratch(ccsv_reader *reader, size_t min_capacity)
+  {
+    size_t capacity = reader->__scratch_capacity > 0 ? reader->__scratch_capacity * 2 : CCSV_BUFFER_SIZE;
+    while (capacity < min_capacity)
+      capacity *= 2;
+
+    char *scratch = (char *)realloc(reader->__scratch, capacity);
+    if (scratch == NULL)
+    {
+      reader->status = CCSV_ERNOMEM;
+      return CCSV_ERNOMEM;
+    }
+    reader->__scratch = scratch;
+    reader->__scratch_capacity = capacity;
+    CCSV_STAT_ADD(reader, buffer_grows, 1);
+    return CCSV_SUCCESS;
+  }
+
+  int _grow_fields(ccsv_reader *reader, int min_capacity)
+  {
+    int capacity = reader->__fields_capacity > 0 ? reader->__fields_capacity * 2 : 16;
+    while (capacity < min_capacity)
+      capacity *= 2;
+
+    ccsv_field_view *fields = (ccsv_field_view *)realloc(reader->__fields, sizeof(ccsv_field_view) * capacity);
+    if (fields == NULL)
+    {
+      reader->status = CCSV_ERNOMEM;
+      return CCSV_ERNOMEM;
+    }
+    reader->__fields = fields;
+
+    size_t *field_starts = (size_t *)realloc(reader->__field_starts, sizeof(size_t) * capacity);
+    if (field_starts == NULL)
+    {
+      reader->status = CCSV_ERNOMEM;
+      return CCSV_ERNOMEM;
+    }
+    reader->__field_starts = field_starts;
+
+    reader->__fields_capacity = capacity;
+    CCSV_STAT_ADD(reader, fields_grows, 1);
+    return CCSV_SUCCESS;
+  }
+
+  void *_arena_alloc(ccsv_arena *arena, size_t size)
+  {
+    /* Keep every allocation pointer aligned */
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    ccsv_arena_chunk *chunk = arena->current;
+    if (chunk != NULL && chunk->size - chunk->used < size)
+    {
+      /* Chunks after the current one are left over from before the last reset */
+      chunk = chunk->next;
+      while (chunk != NULL && chunk->size < size)
+        chunk = chunk->next;
+
+      if (chunk != NULL)
+        chunk->used = 0;
+    }
+
+    if (chunk == NULL)
+    {
+      size_t chunk_size = size > CCSV_ARENA_CHUNK_SIZE ? size : CCSV_ARENA_CHUNK_SIZE;
+      chunk = (ccsv_arena_chunk *)malloc(sizeof(ccsv_arena_chunk) + chunk_size);
+      if (chunk == NULL)
+        return NULL;
+
+      chunk->size = chunk_size;
+      chunk->used = 0;
+
+      if (arena->current == NULL)
+      {
+        chunk->next = arena->head;
+        arena->head = chunk;
+      }
+      else
+      {
+        chunk->next = arena->current->next;
+        arena->current->next = chunk;
+      }
+    }
+
+    arena->current = chunk;
+
+    void *ptr = (char *)(chunk + 1) + chunk->used;
+    chunk->used += size;
+    return ptr;
+  }
+
+  void _arena_release(ccsv_arena *arena)
+  {
+    if (--arena->live_rows > 0)
+      return;
+
+    /* No rows left, a single pointer reset makes all chunks reusable */
+    _arena_reset(arena);
+  }
+
+  void _arena_reset(ccsv_arena *arena)
+  {
+    arena->live_rows = 0;
+    arena->current = arena->head;
+    if (arena->head != NULL)
+      arena->head->used = 0;
+  }
+
+  void _arena_free(ccsv_arena *arena)
+  {
+    ccsv_arena_chunk *chunk = arena->head;
+    while (chunk != NULL)
+    {
+      ccsv_arena_chunk *next = chunk->next;
+      free(chunk);
+      chunk = next;
+    }
+
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->live_rows = 0;
+  }
+
+  int _is_buffer_empty(ccsv_reader *reader)
+  {
+    return reader->__buffer_pos >= reader->__buffer_size;
+  }
+
+/* Header */
+
+  struct ccsv_header
+  {
+    int columns_count;
+    char **names;     /* Interned, NUL terminated copies of the header fields */
+    size_t *lengths;
+    uint32_t *hashes;
+    int *slots;       /* Open addressing table of column + 1, 0 for an empty slot */
+    uint32_t mask;    /* Slots count - 1, the count is a power of two */
+  };
+
+  static uint32_t _header_hash(const char *name, size_t len)
+  {
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+      hash ^= (unsigned char)name[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  int _read_header(ccsv_reader *reader)
+  {
+    /* Every name is unescaped, not only those of projected columns */
+    unsigned char *column_used = reader->__column_used;
+    reader->__column_used = NULL;
+    reader->__header_pending = false;
+    const int fields_count = _parse_record(reader);
+    reader->__column_used = column_used;
+    if (fields_count <= 0)
+    {
+      /* Read again by the next call, a push reader may need more bytes */
+      if (fields_count < 0)
+        reader->__header_pending = true;
+      return fields_count;
+    }
+    reader->rows_read--;
+
+    /* After a seek back to the start the header is only skipped */
+    if (reader->__header == NULL && _build_header(reader, fields_count) != CCSV_SUCCESS)
+    {
+      reader->status = CCSV_ERNOMEM;
+      return CCSV_ERNOMEM;
+    }
+
+    if (reader->__usecols_names != NULL && _resolve_usecols(reader) != CCSV_SUCCESS)
+      return reader->status;
+    return fields_count;
+  }
+
+  int _build_header(ccsv_reader *reader, int fields_count)
+  {
+    const ccsv_field_view *fields = reader->__row_view.fields;
+
+    /* At most half the slots are used, so probes stay short */
+    uint32_t slots_count = 8;
+    while (slots_count < (uint32_t)fields_count * 2)
+      slots_count *= 2;
+
+    /* Table, arrays and names are laid out in a single block */
+    size_t size = sizeof(struct ccsv_header) + (sizeof(char *) + sizeof(size_t)) * fields_count +
+                  sizeof(uint32_t) * fields_count + sizeof(int) * slots_count;
+    for (int i = 0; i < fields_count; i++)
+      size += fields[i].len + 1;
+
+    struct ccsv_header *header = (struct ccsv_header *)calloc(1, size);
+    if (header == NULL)
+      return CCSV_ERNOMEM;
+
+    header->columns_count = fields_count;
+    header->names = (char **)(header + 1);
+    header->lengths = (size_t *)(header->names + fields_count);
+    header->hashes = (uint32_t *)(header->lengths + fields_count);
+    header->slots = (int *)(header->hashes + fields_count);
+    header->mask = slots_count - 1;
+
+    char *name = (char *)(header->slots + slots_count);
+    for (int i = 0; i < fields_count; i++)
+    {
+      /* Fields of a mapped file are not NUL terminated */
+      memcpy(name, fields[i].data, fields[i].len);
+      name[fields[i].len] = CCSV_NULL_CHAR;
+      header->names[i] = name;
+      header->lengths[i] = fields[i].len;
+      header->hashes[i] = _header_hash(name, fields[i].len);
+      name += fields[i].len + 1;
+
+      /* A repeated name keeps its first column */
+      if (_header_lookup(header, header->names[i], header->lengths[i]) >= 0)
+        continue;
+      uint32_t slot = header->hashes[i] & header->mask;
+      while (header->slots[slot] != 0)
+        slot = (slot + 1) & header->mask;
+      header->slots[slot] = i + 1;
+    }
+
+    reader->__header = header;
+    return CCSV_SUCCESS;
+  }
+
+  int _header_lookup(const struct ccsv_header *header, const char *name, size_t len)
+  {
+    const uint32_t hash = _header_hash(name, len);
+    for (uint32_t slot = hash & header->mask; header->slots[slot] != 0; slot = (slot + 1) & header->mask)
+    {
+      const int column = header->slots[slot] - 1;
+      if (header->hashes[column] == hash && header->lengths[column] == len &&
+          memcmp(header->names[column], name, len) == 0)
+        return column;
+    }
+    return -1;
+  }
+
+  int ccsv_column_index(ccsv_reader *reader, const char *name)
+  {
+    if (reader == NULL)
+      return CCSV_ERINVALID;
+
+    if (name == NULL || !reader->__has_header)
+    {
+      reader->status = CCSV_ERINVALID;
+      return CCSV_ERINVALID;
+    }
+
+    if (reader->__header == NULL)
+    {
+      if (_validate_reader(reader) != CCSV_SUCCESS)
+        return reader->status;
+
+      /* No row was read, the next record is the header */
+      if (reader->__header_pending)
+      {
+        const int header_status = _read_header(reader);
+        if (header_status < 0)
+          return header_status;
+      }
+      if (reader->__header == NULL)
+        return CCSV_ERINVALID; /* Empty file */
+    }
+
+    const int column = _header_lookup(reader->__header, name, strlen(name));
+    return column >= 0 ? column : CCSV_ERINVALID;
+  }
+
+  const char *ccsv_column_name(ccsv_reader *reader, int column)
+  {
+    if (reader == NULL || reader->__header == NULL || column < 0 || column >= reader->__header->columns_count)
+      return NULL;
+
+    return reader->__header->names[column];
+  }
+
+/* Dialect sniffing */
+
+  int ccsv_sniff(ccsv_reader *reader, ccsv_reader_options *options)
+  {
+    if (reader == NULL)
+      return CCSV_ERINVALID;
+
+    if (options == NULL)
+    {
+      reader->status = CCSV_ERINVALID;
+      return CCSV_ERINVALID;
+    }
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    /* The dialect can only change before the first record is parsed */
+    if (reader->rows_read != 0 || reader->__header != NULL || reader->__resume.pending ||
+        reader->__buffer_pos != (reader->__mapped ? reader->__bom_size : 0))
+    {
+      reader->status = CCSV_ERINVALID;
+      return CCSV_ERINVALID;
+    }
+
+    if (reader->__buffer_size == 0 && !reader->__eof)
+    {
+      if (reader->__push)
+      {
+        reader->status = CCSV_ERAGAIN;
+        return CCSV_ERAGAIN;
+      }
+
+      /* The first read of the reader, the rows are parsed from this buffer afterwards */
+      const int fill_status = _fill_buffer(reader, 0);
+      if (fill_status != CCSV_SUCCESS)
+        return fill_status;
+    }
+
+    const char *data = reader->__buffer + reader->__buffer_pos;
+    size_t len = reader->__buffer_size - reader->__buffer_pos;
+    const bool at_end = reader->__eof && len <= CCSV_SNIFF_SIZE;
+    if (len > CCSV_SNIFF_SIZE)
+      len = CCSV_SNIFF_SIZE;
+
+    char quote, escape;
+    _sniff_quoting(data, len, &quote, &escape);
+
+    /* Earlier candidates win ties */
+    static const char DELIMITERS[] = {CCSV_DELIMITER, ';', CCSV_TAB, '|'};
+    char delim = DELIMITERS[0];
+    double best_score = 0;
+    for (size_t i = 0; i < sizeof(DELIMITERS); i++)
+    {
+      const double score = _sniff_score(data, len, at_end, DELIMITERS[i], quote, escape);
+      if (score > best_score)
+      {
+        best_score = score;
+        delim = DELIMITERS[i];
+      }
+    }
+    const bool has_header = _sniff_header(data, len, at_end, delim, quote, escape);
+
+    /* Workers of a parallel reader copied the old dialect */
+    _parallel_stop(reader);
+    reader->__delim = delim;
+    reader->__quote_char = quote;
+    reader->__escape_char = escape;
+    reader->__has_header = has_header;
+    reader->__header_pending = has_header;
+    reader->__index.enabled = escape == quote && !reader->__skip_initial_space && !reader->__skip_comments;
+    reader->__index.stale = true;
+    reader->__index.irregular_end = 0;
+    if (reader->__mapped && reader->__threads > 1 && reader->__index.enabled)
+      _parallel_start(reader, reader->__threads);
+
+    memset(options, 0, sizeof(ccsv_reader_options));
+    options->delim = delim;
+    options->quote_char = quote;
+    options->escape_char = escape;
+    options->comment_char = reader->__comment_char;
+    options->skip_initial_space = reader->__skip_initial_space;
+    options->skip_empty_lines = reader->__skip_empty_lines;
+    options->skip_comments = reader->__skip_comments;
+    options->has_header = has_header;
+
+    reader->status = CCSV_SUCCESS;
+    return CCSV_SUCCESS;
+  }
+
+  size_t _sniff_record(const char *data, size_t len, size_t pos, bool at_end, char delim, char quote, char escape,
+                       ccsv_field_view *fields, int max_fields, int *fields_count)
+  {
+    int count = 0;
+    for (;;)
+    {
+      /* One field per pass, pos is at its first byte */
+      size_t start = pos;
+      size_t end = SIZE_MAX;
+      if (pos < len && data[pos] == quote)
+      {
+        start = ++pos;
+        for (;;)
+        {
+          if (pos >= len)
+            return 0; /* Quoted field goes on past the sample */
+          if (data[pos] == escape && escape != quote)
+            pos += 2;
+          else if (data[pos] == quote && escape == quote && pos + 1 < len && data[pos + 1] == quote)
+            pos += 2;
+          else if (data[pos] == quote)
+            break;
+          else
+            pos++;
+        }
+        end = pos++;
+      }
+
+      /* Bytes after a closing quote are kept by the reader, they do not end the field */
+      while (pos < len && data[pos] != delim && data[pos] != CCSV_LF && data[pos] != CCSV_CR)
+        pos++;
+      if (end == SIZE_MAX)
+        end = pos;
+
+      if (fields != NULL && count < max_fields)
+      {
+        fields[count].data = data + start;
+        fields[count].len = end - start;
+      }
+      count++;
+      *fields_count = count;
+
+      if (pos >= len)
+        return at_end ? len : 0;
+      if (data[pos] == delim)
+      {
+        pos++;
+        continue;
+      }
+
+      if (data[pos] == CCSV_CR && pos + 1 < len && data[pos + 1] == CCSV_LF)
+        pos++;
+      return pos + 1;
+    }
+  }
+
+  void _sniff_quoting(const char *data, size_t len, char *quote, char *escape)
+  {
+    /* Quotes that open a field, after a line end or one of the candidate delimiters */
+    size_t double_quotes = 0, single_quotes = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+      if (data[i] != '"' && data[i] != '\'')
+        continue;
+      const char prev = i > 0 ? data[i - 1] : CCSV_LF;
+      if (prev == CCSV_LF || prev == CCSV_CR || prev == CCSV_DELIMITER || prev == ';' || prev == CCSV_TAB || prev == '|')
+      {
+        if (data[i] == '"')
+          double_quotes++;
+        else
+          single_quotes++;
+      }
+    }
+    *quote = single_quotes > double_quotes ? '\'' : CCSV_QUOTE_CHAR;
+
+    /* Doubled quotes inside a field, as opposed to empty quoted fields, or quotes after a backslash */
+    size_t doubled = 0, backslashed = 0;
+    for (size_t i = 0; i + 1 < len; i++)
+    {
+      if (data[i] == '\\' && data[i + 1] == *quote)
+      {
+        backslashed++;
+        i++;
+      }
+      else if (data[i] == *quote && data[i + 1] == *quote)
+      {
+        const char prev = i > 0 ? data[i - 1] : CCSV_LF;
+        if (prev != CCSV_LF && prev != CCSV_CR && prev != CCSV_DELIMITER && prev != ';' && prev != CCSV_TAB &&
+            prev != '|')
+          doubled++;
+        i++;
+      }
+    }
+    *escape = backslashed > 0 && doubled == 0 ? '\\' : *quote;
+  }
+
+  double _sniff_score(const char *data, size_t len, bool at_end, char delim, char quote, char escape)
+  {
+    /*
+     * Records are grouped by their number of fields L, a group of N records
+     * adds N * (L - 1) / L, and the sum is divided by the number of groups.
+     * Delimiters that are in every record the same number of times score
+     * highest, those in no record score 0.
+     */
+    int widths[64];
+    int groups = 0;
+    double sum = 0;
+    size_t pos = 0;
+    while (pos < len)
+    {
+      ccsv_field_view first;
+      int fields_count;
+      const size_t next = _sniff_record(data, len, pos, at_end, delim, quote, escape, &first, 1, &fields_count);
+      if (next == 0)
+        break;
+      pos = next;
+      if (fields_count == 1 && first.len == 0)
+        continue; /* Empty line */
+
+      sum += (double)(fields_count - 1) / fields_count;
+      int group = 0;
+      while (group < groups && widths[group] != fields_count)
+        group++;
+      if (group == groups)
+      {
+        /* Past the table every record counts as a group of its own */
+        if (groups < (int)(sizeof(widths) / sizeof(widths[0])))
+          widths[groups] = fields_count;
+        groups++;
+      }
+    }
+    return groups > 0 ? sum / groups : 0;
+  }
+
+  bool _sniff_header(const char *data, size_t len, bool at_end, char delim, char quote, char escape)
+  {
+    ccsv_field_view header[CCSV_SNIFF_COLUMNS];
+    ccsv_field_view fields[CCSV_SNIFF_COLUMNS];
+    ccsv_column_info columns[CCSV_SNIFF_COLUMNS];
+    size_t lengths[CCSV_SNIFF_COLUMNS]; /* Length of all values of a column, 0 if they differ */
+
+    int columns_count;
+    size_t pos = _sniff_record(data, len, 0, at_end, delim, quote, escape, header, CCSV_SNIFF_COLUMNS, &columns_count);
+    if (pos == 0)
+      return false;
+    if (columns_count > CCSV_SNIFF_COLUMNS)
+      columns_count = CCSV_SNIFF_COLUMNS;
+
+    const unsigned ALL_TYPES = (1u << CCSV_TYPE_INT64) | (1u << CCSV_TYPE_DOUBLE) | (1u << CCSV_TYPE_BOOL) |
+                               (1u << CCSV_TYPE_DATE) | (1u << CCSV_TYPE_TIMESTAMP);
+    for (int i = 0; i < columns_count; i++)
+    {
+      columns[i].__candidates = ALL_TYPES;
+      lengths[i] = SIZE_MAX;
+    }
+
+    for (int rows = 0; rows < CCSV_SNIFF_HEADER_ROWS && pos < len;)
+    {
+      int fields_count;
+      const size_t next = _sniff_record(data, len, pos, at_end, delim, quote, escape, fields, CCSV_SNIFF_COLUMNS,
+                                        &fields_count);
+      if (next == 0)
+        break;
+      pos = next;
+      if (fields_count == 1 && fields[0].len == 0)
+        continue; /* Empty line */
+      rows++;
+
+      for (int i = 0; i < columns_count && i < fields_count; i++)
+      {
+        if (fields[i].len == 0)
+          continue;
+        if (columns[i].__candidates != 0)
+          _infer_value(&columns[i], fields[i].data, fields[i].len);
+        if (lengths[i] == SIZE_MAX)
+          lengths[i] = fields[i].len;
+        else if (lengths[i] != fields[i].len)
+          lengths[i] = 0;
+      }
+    }
+
+    /* Each column votes, a name that is not of the type of its values or of their fixed length is for a header */
+    int votes = 0;
+    for (int i = 0; i < columns_count; i++)
+    {
+      if (lengths[i] == SIZE_MAX || header[i].len == 0)
+        continue; /* Nothing to compare */
+
+      if (columns[i].__candidates != 0)
+      {
+        ccsv_column_info name = columns[i];
+        _infer_value(&name, header[i].data, header[i].len);
+        votes += name.__candidates == 0 ? 1 : -1;
+      }
+      else if (lengths[i] != 0)
+        votes += header[i].len != lengths[i] ? 1 : -1;
+    }
+    return votes > 0;
+  }
+
+/* Row index */
+
+  typedef struct ccsv_row_index_header
+  {
+    char magic[8];
+    uint64_t file_size; /* Size and modification time of the CSV file when it was indexed */
+    int64_t file_mtime;
+    uint64_t interval; /* Rows between entries */
+    uint64_t entries;
+    char dialect[8]; /* Reader options that change what a row is */
+  } ccsv_row_index_header;
+
+  static const char ROW_INDEX_MAGIC[8] = {'C', 'C', 'S', 'V', 'I', 'D', 'X', '1'};
+
+  int _row_index_header(ccsv_reader *reader, ccsv_row_index_header *header)
+  {
+    memset(header, 0, sizeof(ccsv_row_index_header));
+    memcpy(header->magic, ROW_INDEX_MAGIC, sizeof(ROW_INDEX_MAGIC));
+
+    struct stat st;
+    if (reader->__fp == NULL || fstat(fileno(reader->__fp), &st) != 0)
+      return CCSV_ERROR;
+    header->file_size = (uint64_t)st.st_size;
+    header->file_mtime = (int64_t)st.st_mtime;
+
+    header->dialect[0] = reader->__delim;
+    header->dialect[1] = reader->__quote_char;
+    header->dialect[2] = reader->__escape_char;
+    header->dialect[3] = reader->__comment_char;
+    header->dialect[4] = (char)(reader->__skip_initial_space != 0);
+    header->dialect[5] = (char)(reader->__skip_empty_lines != 0);
+    header->dialect[6] = (char)(reader->__skip_comments != 0);
+    header->dialect[7] = (char)reader->__has_header;
+    return CCSV_SUCCESS;
+  }
+
+  uint64_t _tell_offset(const ccsv_reader *reader)
+  {
+    /* __file_pos is the file offset of the end of the buffered data */
+    const size_t offset = reader->__file_pos - reader->__buffer_size + reader->__buffer_pos;
+    return (uint64_t)offset | (reader->__skip_lf ? CCSV_OFFSET_SKIP_LF : 0);
+  }
+
+  int _seek_offset(ccsv_reader *reader, uint64_t saved_offset)
+  {
+    const size_t offset = (size_t)(saved_offset & ~CCSV_OFFSET_SKIP_LF);
+    const bool skip_lf = (saved_offset & CCSV_OFFSET_SKIP_LF) != 0;
+
+    if (reader->__push)
+    {
+      /* Fed bytes are dropped once read */
+      reader->status = CCSV_ERINVALID;
+      return CCSV_ERINVALID;
+    }
+
+    /* Chunks are parsed from the start of the file, past it the reader goes on serially */
+    _parallel_stop(reader);
+
+    /* A skipped BOM is not part of the first record, the reader is still at the start */
+    const bool at_start = offset <= reader->__bom_size;
+
+    if (reader->__mapped)
+    {
+#ifdef CCSV_MMAP
+      if (reader->__map_dirty)
+      {
+        /* Records parsed by the state machine were rewritten in the mapping */
+        munmap(reader->__buffer, reader->__map_size);
+        reader->__buffer = NULL;
+        reader->__mapped = false;
+        if (_map_file(reader, reader->__fp) != CCSV_SUCCESS)
+        {
+          reader->status = CCSV_ERROR;
+          return CCSV_ERROR;
+        }
+      }
+#endif
+      reader->__buffer_pos = at_start ? reader->__bom_size : offset;
+      if (at_start && reader->__threads > 1)
+        _parallel_start(reader, reader->__threads);
+    }
+    else
+    {
+      /* The reading thread owns the file pointer */
+      _read_ahead_stop(reader);
+      const int seek_status = reader->__decoder != NULL
+                                  ? _decoder_seek(reader->__decoder, offset, reader->__buffer, reader->__buffer_capacity)
+                                  : (fseek(reader->__fp, (long)offset, SEEK_SET) == 0 ? CCSV_SUCCESS : CCSV_ERROR);
+      if (seek_status != CCSV_SUCCESS)
+      {
+        reader->status = CCSV_ERROR;
+        return CCSV_ERROR;
+      }
+
+      reader->__file_pos = offset;
+      reader->__buffer_pos = 0;
+      reader->__buffer_size = 0;
+      reader->__buffer[0] = CCSV_NULL_CHAR;
+      reader->__eof = false;
+      reader->__utf8_invalid = false;
+      if (reader->__read_ahead_buffers > 0)
+        _read_ahead_start(reader, reader->__read_ahead_buffers);
+    }
+
+    reader->__skip_lf = skip_lf;
+    reader->__header_pending = reader->__has_header && at_start;
+    reader->__index.stale = true;
+    reader->__index.irregular_end = 0;
+    reader->status = CCSV_SUCCESS;
+    return CCSV_SUCCESS;
+  }
+
+  int ccsv_build_row_index(ccsv_reader *reader, const char *index_path, size_t interval)
+  {
+    if (reader == NULL || index_path == NULL || interval == 0)
+      return CCSV_ERINVALID;
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    ccsv_row_index_header header;
+    if (_row_index_header(reader, &header) != CCSV_SUCCESS || _seek_offset(reader, 0) != CCSV_SUCCESS)
+      return CCSV_ERROR;
+    reader->rows_read = 0;
+
+    /* Offsets are taken from __buffer_pos, which parsed chunks only move at their end */
+    _parallel_stop(reader);
+
+    size_t capacity = 1024;
+    size_t count = 0;
+    uint64_t *offsets = (uint64_t *)malloc(sizeof(uint64_t) * capacity);
+    if (offsets == NULL)
+      return CCSV_ERNOMEM;
+
+    for (size_t row = 0;; row++)
+    {
+      if (row % interval == 0)
+      {
+        if (count == capacity)
+        {
+          uint64_t *temp = (uint64_t *)realloc(offsets, sizeof(uint64_t) * capacity * 2);
+          if (temp == NULL)
+          {
+            free(offsets);
+            return CCSV_ERNOMEM;
+          }
+          offsets = temp;
+          capacity *= 2;
+        }
+
+        offsets[count++] = _tell_offset(reader);
+      }
+
+      const int fields_count = _skip_record(reader);
+      if (fields_count < 0)
+      {
+        free(offsets);
+        return fields_count;
+      }
+      if (fields_count == 0)
+        break;
+    }
+
+    header.interval = interval;
+    header.entries = count;
+
+    FILE *fp = fopen(index_path, "wb");
+    if (fp == NULL)
+    {
+      free(offsets);
+      return CCSV_EROPEN;
+    }
+    const bool written = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                         fwrite(offsets, sizeof(uint64_t), count, fp) == count;
+    if (fclose(fp) != 0 || !written)
+    {
+      free(offsets);
+      return CCSV_ERROR;
+    }
+
+    free(reader->__row_offsets);
+    reader->__row_offsets = offsets;
+    reader->__row_offsets_count = count;
+    reader->__row_interval = interval;
+
+    reader->rows_read = 0;
+    return _seek_offset(reader, 0);
+  }
+
+  int ccsv_load_row_index(ccsv_reader *reader, const char *index_path)
+  {
+    if (reader == NULL || index_path == NULL)
+      return CCSV_ERINVALID;
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    ccsv_row_index_header expected;
+    if (_row_index_header(reader, &expected) != CCSV_SUCCESS)
+      return CCSV_ERROR;
+
+    FILE *fp = fopen(index_path, "rb");
+    if (fp == NULL)
+      return CCSV_EROPEN;
+
+    ccsv_row_index_header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+        header.file_size != expected.file_size ||
+        header.file_mtime != expected.file_mtime ||
+        memcmp(header.dialect, expected.dialect, sizeof(header.dialect)) != 0 ||
+        header.interval == 0 || header.entries == 0)
+    {
+      /* Written for another file, version of the file or dialect */
+      fclose(fp);
+      return CCSV_ERINVALID;
+    }
+
+    uint64_t *offsets = (uint64_t *)malloc(sizeof(uint64_t) * header.entries);
+    if (offsets == NULL)
+    {
+      fclose(fp);
+      return CCSV_ERNOMEM;
+    }
+    if (fread(offsets, sizeof(uint64_t), header.entries, fp) != header.entries)
+    {
+      free(offsets);
+      fclose(fp);
+      return CCSV_ERINVALID;
+    }
+    fclose(fp);
+
+    free(reader->__row_offsets);
+    reader->__row_offsets = offsets;
+    reader->__row_offsets_count = header.entries;
+    reader->__row_interval = header.interval;
+    return CCSV_SUCCESS;
+  }
+
+  int ccsv_seek_row(ccsv_reader *reader, size_t row)
+  {
+    if (reader == NULL)
+      return CCSV_ERINVALID;
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    if ((reader->__usecols_names != NULL || (reader->__has_header && reader->__header == NULL)) &&
+        _resolve_usecols_at_start(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    /* Nearest indexed row at or before the wanted one, the start of the file without an index */
+    size_t entry = 0;
+    uint64_t offset = 0;
+    if (reader->__row_offsets != NULL)
+    {
+      entry = row / reader->__row_interval;
+      if (entry >= reader->__row_offsets_count)
+        entry = reader->__row_offsets_count - 1;
+      offset = reader->__row_offsets[entry];
+    }
+
+    if (_seek_offset(reader, offset) != CCSV_SUCCESS)
+      return reader->status;
+    reader->rows_read = (uint64_t)entry * reader->__row_interval;
+
+    while (reader->rows_read < row)
+    {
+      const int fields_count = _skip_record(reader);
+      if (fields_count < 0)
+        return fields_count;
+      if (fields_count == 0)
+        return CCSV_ERINVALID; /* File has fewer rows */
+    }
+    return CCSV_SUCCESS;
+  }
+
+  int ccsv_tell(ccsv_reader *reader, ccsv_position *position)
+  {
+    if (reader == NULL || position == NULL)
+      return CCSV_ERINVALID;
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    position->__offset = _tell_offset(reader);
+    position->rows_read = reader->rows_read;
+    return CCSV_SUCCESS;
+  }
+
+  int ccsv_seek(ccsv_reader *reader, const ccsv_position *position)
+  {
+    if (reader == NULL || position == NULL)
+      return CCSV_ERINVALID;
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    if ((position->__offset & ~CCSV_OFFSET_SKIP_LF) > reader->__file_size)
+      return CCSV_ERINVALID; /* Not a position in this file */
+
+    if ((reader->__usecols_names != NULL || (reader->__has_header && reader->__header == NULL)) &&
+        _resolve_usecols_at_start(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    if (_seek_offset(reader, position->__offset) != CCSV_SUCCESS)
+      return reader->status;
+    reader->rows_read = position->rows_read;
+    return CCSV_SUCCESS;
+  }
+
+  int _resolve_usecols_at_start(ccsv_reader *reader)
+  {
+    /* Column names are in the first record, read it before moving anywhere else */
+    if (_seek_offset(reader, 0) != CCSV_SUCCESS)
+      return CCSV_ERROR;
+
+    /* The header record looks up the names itself */
+    const int fields_count = reader->__has_header ? _read_header(reader) : _parse_record(reader);
+    if (fields_count < 0 || (fields_count == 0 && reader->__usecols_names != NULL))
+    {
+      reader->status = fields_count < 0 ? fields_count : CCSV_ERINVALID;
+      return reader->status;
+    }
+    if (reader->__usecols_names == NULL)
+      return CCSV_SUCCESS;
+    return _resolve_usecols(reader);
+  }
+
+/* Arrow export */
+
+  struct ccsv_arrow_column
+  {
+    int64_t *offsets;  /* Rows + 1 entries, narrowed to 32 bits on export if the data fits */
+    char *data;
+    uint8_t *validity; /* NULL until the first null */
+    int64_t null_count;
+    int64_t rows_capacity;
+    size_t data_size;
+    size_t data_capacity;
+  };
+
+  /* Buffers and children of an exported array, freed by its release callback */
+  typedef struct ccsv_arrow_array_data
+  {
+    const void *buffers[3];
+    struct ArrowArray **children;
+    struct ArrowArray *child_arrays;
+  } ccsv_arrow_array_data;
+
+  typedef struct ccsv_arrow_schema_data
+  {
+    char *name; /* Stored after the struct */
+    struct ArrowSchema **children;
+    struct ArrowSchema *child_schemas;
+  } ccsv_arrow_schema_data;
+
+  static void _arrow_release_array(struct ArrowArray *array)
+  {
+    ccsv_arrow_array_data *private_data = (ccsv_arrow_array_data *)array->private_data;
+    for (int64_t i = 0; i < array->n_children; i++)
+    {
+      /* Children moved out by the consumer are already released */
+      struct ArrowArray *child = array->children[i];
+      if (child->release != NULL)
+        child->release(child);
+    }
+    for (int i = 0; i < 3; i++)
+      free((void *)private_data->buffers[i]);
+    _free_multiple(3, private_data->children, private_data->child_arrays, private_data);
+    array->release = NULL;
+  }
+
+  static void _arrow_release_schema(struct ArrowSchema *schema)
+  {
+    ccsv_arrow_schema_data *private_data = (ccsv_arrow_schema_data *)schema->private_data;
+    for (int64_t i = 0; i < schema->n_children; i++)
+    {
+      struct ArrowSchema *child = schema->children[i];
+      if (child->release != NULL)
+        child->release(child);
+    }
+    _free_multiple(3, private_data->children, private_data->child_schemas, private_data);
+    schema->release = NULL;
+  }
+
+  int _arrow_reserve(struct ccsv_arrow_column *column, int64_t rows, size_t data_size)
+  {
+    if (rows > column->rows_capacity)
+    {
+      int64_t capacity = column->rows_capacity * 2;
+      if (capacity < CCSV_ARROW_INITIAL_ROWS)
+        capacity = CCSV_ARROW_INITIAL_ROWS;
+      if (capacity < rows)
+        capacity = rows;
+
+      int64_t *offsets = (int64_t *)realloc(column->offsets, sizeof(int64_t) * (capacity + 1));
+      if (offsets == NULL)
+        return CCSV_ERNOMEM;
+      if (column->offsets == NULL)
+        offsets[0] = 0;
+      column->offsets = offsets;
+
+      if (column->validity != NULL)
+      {
+        const size_t old_bytes = (size_t)(column->rows_capacity + 7) / 8;
+        const size_t bytes = (size_t)(capacity + 7) / 8;
+        uint8_t *validity = (uint8_t *)realloc(column->validity, bytes);
+        if (validity == NULL)
+          return CCSV_ERNOMEM;
+        memset(validity + old_bytes, 0, bytes - old_bytes);
+        column->validity = validity;
+      }
+      column->rows_capacity = capacity;
+    }
+
+    /* The data buffer is allocated even if all values are empty, Arrow expects one */
+    const size_t needed = column->data_size + data_size;
+    if (needed > column->data_capacity || column->data == NULL)
+    {
+      size_t capacity = column->data_capacity * 2;
+      if (capacity < needed)
+        capacity = needed < CCSV_BUFFER_SIZE ? CCSV_BUFFER_SIZE : needed;
+      char *data = (char *)realloc(column->data, capacity);
+      if (data == NULL)
+        return CCSV_ERNOMEM;
+      column->data = data;
+      column->data_capacity = capacity;
+    }
+
+    return CCSV_SUCCESS;
+  }
+
+  int _arrow_add_field(struct ccsv_arrow_column *column, int64_t row, const char *data, size_t len)
+  {
+    if (_arrow_reserve(column, row + 1, len) != CCSV_SUCCESS)
+      return CCSV_ERNOMEM;
+
+    memcpy(column->data + column->data_size, data, len);
+    column->data_size += len;
+    column->offsets[row + 1] = (int64_t)column->data_size;
+    if (column->validity != NULL)
+      column->validity[row / 8] |= (uint8_t)(1 << (row % 8));
+    return CCSV_SUCCESS;
+  }
+
+  int _arrow_add_null(struct ccsv_arrow_column *column, int64_t row)
+  {
+    if (_arrow_reserve(column, row + 1, 0) != CCSV_SUCCESS)
+      return CCSV_ERNOMEM;
+
+    if (column->validity == NULL)
+    {
+      /* First null of the column, the rows before it are valid */
+      uint8_t *validity = (uint8_t *)calloc((size_t)(column->rows_capacity + 7) / 8, sizeof(uint8_t));
+      if (validity == NULL)
+        return CCSV_ERNOMEM;
+      memset(validity, 0xFF, (size_t)row / 8);
+      for (int64_t i = row / 8 * 8; i < row; i++)
+        validity[i / 8] |= (uint8_t)(1 << (i % 8));
+      column->validity = validity;
+    }
+
+    column->offsets[row + 1] = (int64_t)column->data_size;
+    column->null_count++;
+    return CCSV_SUCCESS;
+  }
+
+  void _arrow_free_columns(struct ccsv_arrow_column *columns, int columns_count)
+  {
+    for (int i = 0; i < columns_count; i++)
+      _free_multiple(3, columns[i].offsets, columns[i].data, columns[i].validity);
+    free(columns);
+  }
+
+  int ccsv_next_arrow(ccsv_reader *reader, int max_rows, struct ArrowArray *array, struct ArrowSchema *schema)
+  {
+    if (reader == NULL)
+      return CCSV_ERINVALID;
+
+    if (array == NULL || schema == NULL || max_rows <= 0)
+    {
+      reader->status = CCSV_ERINVALID;
+      return CCSV_ERINVALID;
+    }
+
+    if (_validate_reader(reader) != CCSV_SUCCESS)
+      return reader->status;
+
+    struct ccsv_arrow_column *columns = NULL;
+    int columns_count = 0;
+    int64_t rows = 0;
+    int status = CCSV_SUCCESS;
+
+    while (rows < max_rows && status == CCSV_SUCCESS)
+    {
+      const int fields_count = _parse_row(reader);
+      if (fields_count <= 0)
+      {
+        /* Rows read before the end or an error are still exported */
+        if (rows == 0 || fields_count == CCSV_ERNOMEM)
+          status = fields_count;
+        break;
+      }
+
+      if (fields_count > columns_count)
+      {
+        struct ccsv_arrow_column *temp = (struct ccsv_arrow_column *)realloc(
+            columns, sizeof(struct ccsv_arrow_column) * fields_count);
+        if (temp == NULL)
+        {
+          status = CCSV_ERNOMEM;
+          break;
+        }
+        columns = temp;
+        memset(columns + columns_count, 0, sizeof(struct ccsv_arrow_column) * (fields_count - columns_count));
+
+        /* A column first seen in this row is null in the rows before it */
+        for (int i = columns_count; i < fields_count && status == CCSV_SUCCESS; i++)
+        {
+          status = _arrow_reserve(&columns[i], rows, 0);
+          for (int64_t row = 0; row < rows && status == CCSV_SUCCESS; row++)
+            status = _arrow_add_null(&columns[i], row);
+        }
+        columns_count = fields_count;
+      }
+
+      const ccsv_field_view *views = reader->__row_view.fields;
+      for (int i = 0; i < fields_count && status == CCSV_SUCCESS; i++)
+      {
+        struct ccsv_arrow_column *column = &columns[i];
+        const size_t len = views[i].len;
+        if (rows < column->rows_capacity && column->validity == NULL &&
+            column->data_capacity - column->data_size >= len)
+        {
+          /* Room left and no nulls so far, the common case */
+          memcpy(column->data + column->data_size, views[i].data, len);
+          column->data_size += len;
+          column->offsets[rows + 1] = (int64_t)column->data_size;
+        }
+        else
+          status = _arrow_add_field(column, rows, views[i].data, len);
+      }
+      for (int i = fields_count; i < columns_count && status == CCSV_SUCCESS; i++)
+        status = _arrow_add_null(&columns[i], rows);
+      rows++;
+    }
+
+    if (status != CCSV_SUCCESS || rows == 0)
+    {
+      _arrow_free_columns(columns, columns_count);
+      if (status == CCSV_ERNOMEM)
+        reader->status = CCSV_ERNOMEM;
+      return status;
+    }
+
+    if (_arrow_export(reader, columns, columns_count, rows, array, schema) != CCSV_SUCCESS)
+    {
+      _arrow_free_columns(columns, columns_count);
+      reader->status = CCSV_ERNOMEM;
+      return CCSV_ERNOMEM;
+    }
+
+    /* The buffers are owned by array now */
+    free(columns);
+    return (int)rows;
+  }
+
+  int _arrow_export(ccsv_reader *reader, struct ccsv_arrow_column *columns, int columns_count, int64_t rows,
+                    struct ArrowArray *array, struct ArrowSchema *schema)
+  {
+    /* Everything that can fail is allocated first, so the columns are handed over whole */
+    ccsv_arrow_array_data *array_data = (ccsv_arrow_array_data *)calloc(1, sizeof(ccsv_arrow_array_data));
+    ccsv_arrow_schema_data *schema_data = (ccsv_arrow_schema_data *)calloc(1, sizeof(ccsv_arrow_schema_data));
+    struct ArrowArray **child_array_ptrs = (struct ArrowArray **)malloc(sizeof(struct ArrowArray *) * columns_count);
+    struct ArrowArray *child_arrays = (struct ArrowArray *)calloc(columns_count, sizeof(struct ArrowArray));
+    struct ArrowSchema **child_schema_ptrs = (struct ArrowSchema **)malloc(sizeof(struct ArrowSchema *) * columns_count);
+    struct ArrowSchema *child_schemas = (struct ArrowSchema *)calloc(columns_count, sizeof(struct ArrowSchema));
+    bool allocated = array_data != NULL && schema_data != NULL && child_array_ptrs != NULL && child_arrays != NULL &&
+                     child_schema_ptrs != NULL && child_schemas != NULL;
+
+    /* Children have their own private data, a consumer may move them out and release them later */
+    for (int i = 0; i < columns_count && allocated; i++)
+    {
+      /* Columns are named after the header, or f0, f1, ... without one */
+      const int column_index = reader->__usecols_count > 0 ? reader->__usecols[i] : i;
+      const char *header_name = ccsv_column_name(reader, column_index);
+      const size_t name_size = header_name != NULL ? strlen(header_name) + 1 : 24;
+
+      child_arrays[i].private_data = calloc(1, sizeof(ccsv_arrow_array_data));
+      ccsv_arrow_schema_data *names = (ccsv_arrow_schema_data *)calloc(1, sizeof(ccsv_arrow_schema_data) + name_size);
+      child_schemas[i].private_data = names;
+      allocated = child_arrays[i].private_data != NULL && names != NULL;
+      if (names != NULL)
+      {
+        names->name = (char *)(names + 1);
+        if (header_name != NULL)
+          memcpy(names->name, header_name, name_size);
+        else
+          snprintf(names->name, name_size, "f%d", column_index);
+      }
+    }
+
+    if (!allocated)
+    {
+      for (int i = 0; child_arrays != NULL && child_schemas != NULL && i < columns_count; i++)
+        _free_multiple(2, child_arrays[i].private_data, child_schemas[i].private_data);
+      _free_multiple(6, array_data, schema_data, child_array_ptrs, child_arrays, child_schema_ptrs, child_schemas);
+      return CCSV_ERNOMEM;
+    }
+
+    for (int i = 0; i < columns_count; i++)
+    {
+      struct ccsv_arrow_column *column = &columns[i];
+
+      /* 32-bit offsets are the common utf8 type, the 64-bit ones are narrowed in place */
+      const bool large = column->data_size > (size_t)INT32_MAX;
+      if (!large)
+      {
+        char *bytes = (char *)column->offsets;
+        for (int64_t row = 0; row <= rows; row++)
+        {
+          int64_t offset;
+          memcpy(&offset, bytes + row * sizeof(int64_t), sizeof(int64_t));
+          const int32_t narrow = (int32_t)offset;
+          memcpy(bytes + row * sizeof(int32_t), &narrow, sizeof(int32_t));
+        }
+      }
+
+      struct ArrowArray *child = &child_arrays[i];
+      ccsv_arrow_array_data *data = (ccsv_arrow_array_data *)child->private_data;
+      data->buffers[0] = column->validity;
+      data->buffers[1] = column->offsets;
+      data->buffers[2] = column->data;
+      child->length = rows;
+      child->null_count = column->null_count;
+      child->offset = 0;
+      child->n_buffers = 3;
+      child->n_children = 0;
+      child->buffers = data->buffers;
+      child->children = NULL;
+      child->dictionary = NULL;
+      child->release = _arrow_release_array;
+      child_array_ptrs[i] = child;
+
+      struct ArrowSchema *child_schema = &child_schemas[i];
+      ccsv_arrow_schema_data *names = (ccsv_arrow_schema_data *)child_schema->private_data;
+      child_schema->format = large ? "U" : "u";
+      child_schema->name = names->name;
+      child_schema->metadata = NULL;
+      child_schema->flags = ARROW_FLAG_NULLABLE;
+      child_schema->n_children = 0;
+      child_schema->children = NULL;
+      child_schema->dictionary = NULL;
+      child_schema->release = _arrow_release_schema;
+      child_schema_ptrs[i] = child_schema;
+    }
+
+    array_data->children = child_array_ptrs;
+    array_data->child_arrays = child_arrays;
+    array->length = rows;
+    array->null_count = 0;
+    array->offset = 0;
+    array->n_buffers = 1;
+    array->n_children = columns_count;
+    array->buffers = array_data->buffers;
+    array->children = child_array_ptrs;
+    array->dictionary = NULL;
+    array->release = _arrow_release_array;
+    array->private_data = array_data;
+
+    schema_data->children = child_schema_ptrs;
+    schema_data->child_schemas = child_schemas;
+    schema->format = "+s";
+    schema->name = "";
+    schema->metadata = NULL;
+    schema->flags = 0;
+    schema->n_children = columns_count;
+    schema->children = child_schema_ptrs;
+    schema->dictionary = NULL;
+    schema->release = _arrow_release_schema;
+    schema->private_data = schema_data;
+    return CCSV_SUCCESS;
+  }
+
+/* Read-ahead */
+
+#ifdef CCSV_THREADS
+  typedef struct ccsv_read_block
+  {
+    char *data;
+    size_t size; /* Bytes read into the block */
+    size_t pos;  /* Bytes handed to the reader */
+  } ccsv_read_block;
+
+  struct ccsv_read_ahead
+  {
+    FILE *fp;
+    struct ccsv_decoder *decoder; /* Decompression runs on the reading thread too */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;  /* Signalled to the reader */
+    pthread_cond_t drained; /* Signalled to the reading thread */
+    ccsv_read_block *blocks;
+    int blocks_count;
+    size_t block_size;
+    int head;  /* Block the reader takes bytes from */
+    int ready; /* Filled blocks starting at head */
+    bool eof;
+    bool stop;
+  };
+
+  static void *_read_ahead_worker(void *arg)
+  {
+    struct ccsv_read_ahead *read_ahead = (struct ccsv_read_ahead *)arg;
+
+    pthread_mutex_lock(&read_ahead->lock);
+    for (;;)
+    {
+      while (!read_ahead->stop && read_ahead->ready == read_ahead->blocks_count)
+        pthread_cond_wait(&read_ahead->drained, &read_ahead->lock);
+      if (read_ahead->stop)
+        break;
+
+      /* The reader never touches blocks past the ready ones */
+      ccsv_read_block *block = &read_ahead->blocks[(read_ahead->head + read_ahead->ready) % read_ahead->blocks_count];
+      pthread_mutex_unlock(&read_ahead->lock);
+
+      const size_t bytes_read = _read_source(read_ahead->fp, read_ahead->decoder, block->data, read_ahead->block_size);
+
+      pthread_mutex_lock(&read_ahead->lock);
+      block->size = bytes_read;
+      block->pos = 0;
+      if (bytes_read == 0)
+      {
+        read_ahead->eof = true;
+        pthread_cond_signal(&read_ahead->filled);
+        break;
+      }
+      read_ahead->ready++;
+      pthread_cond_signal(&read_ahead->filled);
+    }
+    pthread_mutex_unlock(&read_ahead->lock);
+    return NULL;
+  }
+#endif
+
+  int _read_ahead_start(ccsv_reader *reader, int buffers)
+  {
+#ifdef CCSV_THREADS
+    struct ccsv_read_ahead *read_ahead = (struct ccsv_read_ahead *)calloc(1, sizeof(struct ccsv_read_ahead));
+    if (read_ahead == NULL)
+      return CCSV_ERNOMEM;
+
+    read_ahead->blocks = (ccsv_read_block *)calloc(buffers, sizeof(ccsv_read_block));
+    if (read_ahead->blocks == NULL)
+    {
+      free(read_ahead);
+      return CCSV_ERNOMEM;
+    }
+
+    /* A block fills the reader buffer in one go */
+    read_ahead->block_size = reader->__buffer_capacity;
+    read_ahead->blocks_count = buffers;
+    read_ahead->fp = reader->__fp;
+    read_ahead->decoder = reader->__decoder;
+    for (int i = 0; i < buffers; i++)
+    {
+      read_ahead->blocks[i].data = (char *)malloc(read_ahead->block_size);
+      if (read_ahead->blocks[i].data == NULL)
+      {
+        for (int j = 0; j < i; j++)
+          free(read_ahead->blocks[j].data);
+        _free_multiple(2, read_ahead->blocks, read_ahead);
+        return CCSV_ERNOMEM;
+      }
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fileno(reader->__fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    pthread_mutex_init(&read_ahead->lock, NULL);
+    pthread_cond_init(&read_ahead->filled, NULL);
+    pthread_cond_init(&read_ahead->drained, NULL);
+
+    if (pthread_create(&read_ahead->thread, NULL, _read_ahead_worker, read_ahead) != 0)
+    {
+      pthread_mutex_destroy(&read_ahead->lock);
+      pthread_cond_destroy(&read_ahead->filled);
+      pthread_cond_destroy(&read_ahead->drained);
+      for (int i = 0; i < buffers; i++)
+        free(read_ahead->blocks[i].data);
+      _free_multiple(2, read_ahead->blocks, read_ahead);
+      return CCSV_ERROR;
+    }
+
+    reader->__read_ahead = read_ahead;
+    return CCSV_SUCCESS;
+#else
+    (void)reader;
+    (void)buffers;
+    return CCSV_ERROR;
+#endif
+  }
+
+  void _read_ahead_stop(ccsv_reader *reader)
+  {
+#ifdef CCSV_THREADS
+    struct ccsv_read_ahead *read_ahead = reader->__read_ahead;
+    if (read_ahead == NULL)
+      return;
+
+    pthread_mutex_lock(&read_ahead->lock);
+    read_ahead->stop = true;
+    pthread_cond_signal(&read_ahead->drained);
+    pthread_mutex_unlock(&read_ahead->lock);
+    pthread_join(read_ahead->thread, NULL);
+
+    pthread_mutex_destroy(&read_ahead->lock);
+    pthread_cond_destroy(&read_ahead->filled);
+    pthread_cond_destroy(&read_ahead->drained);
+    for (int i = 0; i < read_ahead->blocks_count; i++)
+      free(read_ahead->blocks[i].data);
+    _free_multiple(2, read_ahead->blocks, read_ahead);
+    reader->__read_ahead = NULL;
+#else
+    (void)reader;
+#endif
+  }
+
+  size_t _read_ahead(ccsv_reader *reader, char *dst, size_t size)
+  {
+#ifdef CCSV_THREADS
+    struct ccsv_read_ahead *read_ahead = reader->__read_ahead;
+    size_t copied = 0;
+
+    pthread_mutex_lock(&read_ahead->lock);
+    while (copied < size)
+    {
+      /* Wait only if nothing was copied yet, the parser can go on with what it has */
+      while (read_ahead->ready == 0 && !read_ahead->eof && copied == 0)
+        pthread_cond_wait(&read_ahead->filled, &read_ahead->lock);
+      if (read_ahead->ready == 0)
+        break;
+      pthread_mutex_unlock(&read_ahead->lock);
+
+      ccsv_read_block *block = &read_ahead->blocks[read_ahead->head];
+      size_t n = block->size - block->pos;
+      if (n > size - copied)
+        n = size - copied;
+      memcpy(dst + copied, block->data + block->pos, n);
+      block->pos += n;
+      copied += n;
+
+      pthread_mutex_lock(&read_ahead->lock);
+      if (block->pos == block->size)
+      {
+        /* Block used up, hand it back to be filled */
+        read_ahead->head = (read_ahead->head + 1) % read_ahead->blocks_count;
+        read_ahead->ready--;
+        pthread_cond_signal(&read_ahead->drained);
+      }
+    }
+    pthread_mutex_unlock(&read_ahead->lock);
+    return copied;
+#else
+    (void)reader;
+    (void)dst;
+    (void)size;
+    return 0;
+#endif
+  }
+
+/* Decompression */
+
+  typedef enum ccsv_compression
+  {
+    CCSV_COMPRESSION_NONE, /* Plain pipe that started like a zstd file, the peeked bytes are given back */
+    CCSV_COMPRESSION_GZIP,
+    CCSV_COMPRESSION_ZSTD
+  } ccsv_compression;
+
+  struct ccsv_decoder
+  {
+    FILE *fp;
+    ccsv_compression compression;
+    unsigned char *input; /* Compressed bytes read from the file */
+    size_t input_size;
+    size_t input_pos;
+    bool input_eof;
+    bool in_frame; /* Bytes of an unfinished gzip member or zstd frame were consumed */
+    bool failed;
+#ifdef CCSV_ZLIB
+    z_stream zlib;
+#endif
+#ifdef CCSV_ZSTD
+    ZSTD_DCtx *zstd;
+#endif
+  };
+
+  static const unsigned char GZIP_MAGIC[2] = {0x1f, 0x8b};
+  static const unsigned char ZSTD_MAGIC[4] = {0x28, 0xb5, 0x2f, 0xfd};
+
+  size_t _read_source(FILE *fp, struct ccsv_decoder *decoder, char *dst, size_t size)
+  {
+    if (decoder != NULL)
+      return _decoder_read(decoder, dst, size);
+    return fread(dst, sizeof(char), size, fp);
+  }
+
+  int _decoder_open(ccsv_reader *reader, FILE *fp)
+  {
+    /* Only the first byte can be pushed back on a pipe, it is enough for a CSV file */
+    const int first = getc(fp);
+    if (first == EOF)
+    {
+      clearerr(fp);
+      return CCSV_SUCCESS;
+    }
+    if (first != GZIP_MAGIC[0] && first != ZSTD_MAGIC[0])
+    {
+      ungetc(first, fp);
+      return CCSV_SUCCESS;
+    }
+
+    unsigned char magic[4];
+    magic[0] = (unsigned char)first;
+    const size_t magic_size = 1 + fread(magic + 1, sizeof(unsigned char), sizeof(magic) - 1, fp);
+
+    ccsv_compression compression;
+    if (magic_size >= sizeof(GZIP_MAGIC) && memcmp(magic, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0)
+      compression = CCSV_COMPRESSION_GZIP;
+    else if (magic_size >= sizeof(ZSTD_MAGIC) && memcmp(magic, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0)
+      compression = CCSV_COMPRESSION_ZSTD;
+    else
+    {
+      /* A plain file that starts like a zstd frame */
+      clearerr(fp);
+      if (fseek(fp, 0, SEEK_SET) == 0)
+        return CCSV_SUCCESS;
+      compression = CCSV_COMPRESSION_NONE;
+    }
+
+#ifndef CCSV_ZLIB
+    if (compression == CCSV_COMPRESSION_GZIP)
+      return CCSV_ERDECODE;
+#endif
+#ifndef CCSV_ZSTD
+    if (compression == CCSV_COMPRESSION_ZSTD)
+      return CCSV_ERDECODE;
+#endif
+
+    struct ccsv_decoder *decoder = (struct ccsv_decoder *)calloc(1, sizeof(struct ccsv_decoder));
+    unsigned char *input = (unsigned char *)malloc(CCSV_DECODER_INPUT_SIZE);
+    if (decoder == NULL || input == NULL)
+    {
+      _free_multiple(2, decoder, input);
+      return CCSV_ERNOMEM;
+    }
+    decoder->fp = fp;
+    decoder->compression = compression;
+    decoder->input = input;
+
+    /* The magic bytes are decompressed first, the file may not be seekable */
+    memcpy(input, magic, magic_size);
+    decoder->input_size = magic_size;
+
+    bool started = compression == CCSV_COMPRESSION_NONE;
+#ifdef CCSV_ZLIB
+    /* 15 + 16 window bits accept a gzip header */
+    if (compression == CCSV_COMPRESSION_GZIP)
+      started = inflateInit2(&decoder->zlib, 15 + 16) == Z_OK;
+#endif
+#ifdef CCSV_ZSTD
+    if (compression == CCSV_COMPRESSION_ZSTD)
+    {
+      decoder->zstd = ZSTD_createDCtx();
+      started = decoder->zstd != NULL;
+    }
+#endif
+    if (!started)
+    {
+      _free_multiple(2, decoder, input);
+      return CCSV_ERNOMEM;
+    }
+
+    reader->__decoder = decoder;
+    return CCSV_SUCCESS;
+  }
+
+  size_t _decoder_read(struct ccsv_decoder *decoder, char *dst, size_t size)
+  {
+    if (decoder->compression == CCSV_COMPRESSION_NONE)
+    {
+      size_t peeked = decoder->input_size - decoder->input_pos;
+      if (peeked > size)
+        peeked = size;
+      memcpy(dst, decoder->input + decoder->input_pos, peeked);
+      decoder->input_pos += peeked;
+      return peeked + fread(dst + peeked, sizeof(char), size - peeked, decoder->fp);
+    }
+
+    size_t produced = 0;
+    while (produced < size && !decoder->failed)
+    {
+      if (decoder->input_pos == decoder->input_size && !decoder->input_eof)
+      {
+        decoder->input_size = fread(decoder->input, sizeof(unsigned char), CCSV_DECODER_INPUT_SIZE, decoder->fp);
+        decoder->input_pos = 0;
+        decoder->input_eof = decoder->input_size == 0;
+      }
+
+      const size_t input_left = decoder->input_size - decoder->input_pos;
+      size_t consumed = 0;
+      size_t written = 0;
+      bool frame_end = false;
+      bool error = false;
+
+#ifdef CCSV_ZLIB
+      if (decoder->compression == CCSV_COMPRESSION_GZIP)
+      {
+        /* zlib counts are 32 bits */
+        const size_t output_left = size - produced < UINT_MAX ? size - produced : UINT_MAX;
+        z_stream *zlib = &decoder->zlib;
+        zlib->next_in = decoder->input + decoder->input_pos;
+        zlib->avail_in = (uInt)input_left;
+        zlib->next_out = (Bytef *)dst + produced;
+        zlib->avail_out = (uInt)output_left;
+
+        const int ret = inflate(zlib, Z_NO_FLUSH);
+        consumed = input_left - zlib->avail_in;
+        written = output_left - zlib->avail_out;
+        if (ret == Z_STREAM_END)
+        {
+          /* Concatenated gzip members are read as one file */
+          frame_end = true;
+          inflateReset(zlib);
+        }
+        else if (ret != Z_OK && ret != Z_BUF_ERROR)
+          error = true;
+      }
+#endif
+#ifdef CCSV_ZSTD
+      if (decoder->compression == CCSV_COMPRESSION_ZSTD)
+      {
+        ZSTD_inBuffer in = {decoder->input + decoder->input_pos, input_left, 0};
+        ZSTD_outBuffer out = {dst + produced, size - produced, 0};
+
+        /* Frames follow each other in the same context */
+        const size_t ret = ZSTD_decompressStream(decoder->zstd, &out, &in);
+        consumed = in.pos;
+        written = out.pos;
+        if (ZSTD_isError(ret))
+          error = true;
+        else if (ret == 0)
+          frame_end = true;
+      }
+#endif
+
+#if !defined(CCSV_ZLIB) && !defined(CCSV_ZSTD)
+      (void)dst;
+      (void)input_left;
+#endif
+
+      decoder->input_pos += consumed;
+      produced += written;
+      if (frame_end)
+        decoder->in_frame = false;
+      else if (consumed > 0)
+        decoder->in_frame = true;
+
+      /* A file cut inside a frame is corrupt as well */
+      if (error || (consumed == 0 && written == 0 && decoder->input_eof))
+      {
+        decoder->failed = error || decoder->in_frame;
+        break;
+      }
+    }
+    return produced;
+  }
+
+  int _decoder_seek(struct ccsv_decoder *decoder, size_t offset, char *scratch, size_t scratch_size)
+  {
+    clearerr(decoder->fp);
+    if (fseek(decoder->fp, 0, SEEK_SET) != 0)
+      return CCSV_ERROR;
+
+    decoder->input_size = 0;
+    decoder->input_pos = 0;
+    decoder->input_eof = false;
+    decoder->in_frame = false;
+    decoder->failed = false;
+#ifdef CCSV_ZLIB
+    if (decoder->compression == CCSV_COMPRESSION_GZIP)
+      inflateReset(&decoder->zlib);
+#endif
+#ifdef CCSV_ZSTD
+    if (decoder->compression == CCSV_COMPRESSION_ZSTD)
+      ZSTD_DCtx_reset(decoder->zstd, ZSTD_reset_session_only);
+#endif
+
+    /* Compressed streams have no random access, the bytes before offset are decompressed and dropped */
+    while (offset > 0)
+    {
+      const size_t skipped = _decoder_read(decoder, scratch, offset < scratch_size ? offset : scratch_size);
+      if (skipped == 0)
+        return CCSV_ERROR;
+      offset -= skipped;
+    }
+    return CCSV_SUCCESS;
+  }
+
+  bool _decoder_failed(const struct ccsv_decoder *decoder)
+  {
+    return decoder->failed;
+  }
+
+  void _decoder_free(ccsv_reader *reader)
+  {
+    struct ccsv_decoder *decoder = reader->__decoder;
+    if (decoder == NULL)
+      return;
+
+#ifdef CCSV_ZLIB
+    if (decoder->compression == CCSV_COMPRESSION_GZIP)
+      inflateEnd(&decoder->zlib);
+#endif
+#ifdef CCSV_ZSTD
+    if (decoder->compression == CCSV_COMPRESSION_ZSTD)
+      ZSTD_freeDCtx(decoder->zstd);
+#endif
+    _free_multiple(2, decoder->input, decoder);
+    reader->__decoder = NULL;
+  }
+
+
+/* Follow */
+
+  /* Monotonic clock in milliseconds, for follow timeouts */
+  static uint64_t _follow_clock(void)
+  {
+#ifdef _WIN32
+    return (uint64_t)GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+#endif
+  }
+
+  /* Waits up to one poll interval, less if the watched file is written to */
+  static void _follow_wait(ccsv_reader *reader)
+  {
+    const int interval = reader->__follow;
+#ifdef CCSV_INOTIFY
+    if (reader->__follow_fd >= 0)
+    {
+      struct pollfd watch = {reader->__follow_fd, POLLIN, 0};
+      if (poll(&watch, 1, interval) > 0)
+      {
+        /* Drain the events, the file is read again anyway */
+        char events[4096];
+        while (read(reader->__follow_fd, events, sizeof(events)) > 0)
+          ;
+      }
+      return;
+    }
+#endif
+#ifdef _WIN32
+    Sleep((DWORD)interval);
+#else
+    struct timespec delay = {interval / 1000, (long)(interval % 1000) * 1000000};
+    nanosleep(&delay, NULL);
+#endif
+  }
+
+  int _follow_watch(FILE *fp)
+  {
+#ifdef CCSV_INOTIFY
+    /* The stream may not have a name, watch the file it has open */
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fileno(fp));
+
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+      return -1;
+
+    if (inotify_add_watch(fd, path, IN_MODIFY | IN_CLOSE_WRITE) < 0)
+    {
+      close(fd);
+      return -1;
+    }
+    return fd;
+#else
+    (void)fp;
+    return -1;
+#endif
+  }
+
+  size_t _follow_read(ccsv_reader *reader, char *dst, size_t size, bool at_record_boundary)
+  {
+    const uint64_t started = _follow_clock();
+    for (;;)
+    {
+      _follow_wait(reader);
+
+      /* Clear the end of file flag so fread() looks at the file again */
+      clearerr(reader->__fp);
+      const size_t bytes_read = fread(dst, sizeof(char), size, reader->__fp);
+      if (bytes_read > 0)
+        return bytes_read;
+
+      /* A partial record has been unescaped in place, so it is waited for to the end */
+      if (at_record_boundary && reader->__follow_timeout > 0 &&
+          _follow_clock() - started >= (uint64_t)reader->__follow_timeout)
+        return 0;
+    }
+  }
+
+/* Parallel reader */
+
+#ifdef CCSV_THREADS
+  typedef enum ChunkState
+  {
+    CHUNK_EMPTY,    /* Slot is free */
+    CHUNK_COUNTING, /* Quotes of the chunk are being counted */
+    CHUNK_COUNTED,  /* Quotes counted, waiting for the quote state at its start */
+    CHUNK_PARSING,  /* Records of the chunk are being parsed */
+    CHUNK_PARSED    /* Ready to be handed out */
+  } ChunkState;
+
+  typedef struct ccsv_chunk
+  {
+    size_t number;
+    size_t start; /* Records starting in [start, end) belong to the chunk */
+    size_t end;
+    size_t quotes;
+    bool in_quotes; /* Quote state at start */
+    ChunkState state;
+    int status;
+    bool irregular; /* Quotes not at field boundaries, the chunk needs the state machine */
+    size_t row_start; /* Offset of the first record */
+    size_t row_end;   /* Offset after the last record */
+    ccsv_field_view *fields;
+    size_t fields_count;
+    size_t fields_capacity;
+    int *row_sizes;    /* Fields of each record */
+    uint64_t *row_ends; /* Where the reader stands after each record, as saved by _tell_offset() */
+    size_t rows_count;
+    size_t rows_capacity;
+    size_t lines_skipped; /* Empty lines left out, added to the reader counters */
+    ccsv_arena arena; /* Unescaped fields */
+  } ccsv_chunk;
+
+  struct ccsv_parallel
+  {
+    ccsv_reader proto; /* Copy of the reader the workers start from */
+    pthread_t *threads;
+    int threads_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready; /* Signalled to workers */
+    pthread_cond_t chunk_done; /* Signalled to the caller */
+    ccsv_chunk *slots;         /* Chunk n is kept in slot n % slots_count */
+    size_t slots_count;
+    size_t chunks_count;
+    size_t next_count;   /* Next chunk to count quotes in */
+    size_t parity_known; /* Chunks before this one know their starting quote state */
+    bool in_quotes;      /* Quote state at the start of chunk parity_known */
+    size_t consumed;     /* Chunk being handed out */
+    size_t next_row;
+    size_t next_field;
+    bool stop;
+  };
+
+  static size_t _count_char(const char *buffer, size_t start, size_t end, char c)
+  {
+    size_t count = 0;
+    size_t pos = start;
+#ifdef CCSV_SIMD_X86
+    const __m128i vc = _mm_set1_epi8(c);
+    for (; pos + 16 <= end; pos += 16)
+    {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(buffer + pos));
+      count += __builtin_popcount((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)));
+    }
+#endif
+    for (; pos < end; pos++)
+      count += buffer[pos] == c;
+    return count;
+  }
+
+  /* Offset of the first record starting at or after start, given the quote state at start */
+  static size_t _chunk_row_start(const ccsv_reader *reader, size_t start, bool in_quotes)
+  {
+    const char *buffer = reader->__buffer;
+    const size_t size = reader->__buffer_size;
+    const char QUOTE_CHAR = reader->__quote_char;
+
+    /* The byte before start was counted in the previous chunk, a record may start right at start */
+    size_t pos = start - 1;
+    if (in_quotes || !IS_TERMINATOR(buffer[pos]))
+    {
+      for (pos = start; pos < size; pos++)
+      {
+        const char c = buffer[pos];
+        if (c == QUOTE_CHAR)
+          in_quotes = !in_quotes;
+        else if (!in_quotes && IS_TERMINATOR(c))
+          break;
+      }
+      if (pos >= size)
+        return size;
+    }
+
+    /* LF of a CRLF belongs to the record before */
+    if (buffer[pos] == CCSV_CR && pos + 1 < size && buffer[pos + 1] == CCSV_LF)
+      pos++;
+    return pos + 1;
+  }
+
+  static int _parse_chunk(ccsv_reader *worker, ccsv_chunk *chunk)
+  {
+    const size_t size = worker->__buffer_size;
+    const int SKIP_EMPTY_LINES = worker->__skip_empty_lines;
+
+    chunk->fields_count = 0;
+    chunk->rows_count = 0;
+    chunk->lines_skipped = 0;
+    chunk->irregular = false;
+    _arena_reset(&chunk->arena);
+
+    const size_t row_start =
+        chunk->start == 0 ? worker->__bom_size : _chunk_row_start(worker, chunk->start, chunk->in_quotes);
+    chunk->row_start = row_start;
+
+    /* Empty lines are records here so every chunk starts on a line, they are dropped below */
+    worker->__skip_empty_lines = 0;
+    worker->__buffer_pos = row_start;
+    worker->__skip_lf = false;
+    _index_reset(worker, row_start);
+
+    int status = CCSV_SUCCESS;
+    for (;;)
+    {
+      size_t record_start;
+      const int fields_count = _index_next_record(worker, &record_start);
+      if (fields_count == CCSV_INDEX_FALLBACK)
+      {
+        chunk->irregular = true;
+        break;
+      }
+      if (fields_count < 0)
+      {
+        status = fields_count;
+        break;
+      }
+      if (fields_count == 0 || record_start >= chunk->end)
+      {
+        /* Records from here on belong to the next chunk */
+        worker->__buffer_pos = fields_count == 0 ? size : record_start;
+        break;
+      }
+
+      const bool empty_line = fields_count == 1 &&
+                              (worker->__field_starts[0] & ~CCSV_FIELD_ESCAPED) == record_start;
+      if (_index_emit_record(worker, record_start, fields_count) < 0)
+      {
+        status = CCSV_ERNOMEM;
+        break;
+      }
+      if (SKIP_EMPTY_LINES && empty_line)
+      {
+        chunk->lines_skipped++;
+        continue;
+      }
+
+      if (chunk->rows_count == chunk->rows_capacity)
+      {
+        const size_t capacity = chunk->rows_capacity > 0 ? chunk->rows_capacity * 2 : 1024;
+        int *row_sizes = (int *)realloc(chunk->row_sizes, sizeof(int) * capacity);
+        if (row_sizes == NULL)
+        {
+          status = CCSV_ERNOMEM;
+          break;
+        }
+        chunk->row_sizes = row_sizes;
+
+        uint64_t *row_ends = (uint64_t *)realloc(chunk->row_ends, sizeof(uint64_t) * capacity);
+        if (row_ends == NULL)
+        {
+          status = CCSV_ERNOMEM;
+          break;
+        }
+        chunk->row_ends = row_ends;
+        chunk->rows_capacity = capacity;
+      }
+
+      if (chunk->fields_count + fields_count > chunk->fields_capacity)
+      {
+        size_t capacity = chunk->fields_capacity > 0 ? chunk->fields_capacity * 2 : 4096;
+        while (capacity < chunk->fields_count + fields_count)
+          capacity *= 2;
+        ccsv_field_view *fields = (ccsv_field_view *)realloc(chunk->fields, sizeof(ccsv_field_view) * capacity);
+        if (fields == NULL)
+        {
+          status = CCSV_ERNOMEM;
+          break;
+        }
+        chunk->fields = fields;
+        chunk->fields_capacity = capacity;
+      }
+
+      const ccsv_field_view *views = worker->__fields;
+      ccsv_field_view *fields = chunk->fields + chunk->fields_count;
+      for (int i = 0; i < fields_count; i++)
+      {
+        fields[i] = views[i];
+        if (views[i].data >= worker->__scratch && views[i].data < worker->__scratch + worker->__scratch_capacity)
+        {
+          /* Unescaped into the worker scratch buffer, which the next record reuses */
+          char *field = (char *)_arena_alloc(&chunk->arena, views[i].len + 1);
+          if (field == NULL)
+          {
+            status = CCSV_ERNOMEM;
+            break;
+          }
+          memcpy(field, views[i].data, views[i].len + 1);
+          fields[i].data = field;
+        }
+      }
+      if (status != CCSV_SUCCESS)
+        break;
+
+      chunk->fields_count += fields_count;
+      chunk->row_ends[chunk->rows_count] = (uint64_t)worker->__buffer_pos |
+                                           (worker->__skip_lf ? CCSV_OFFSET_SKIP_LF : 0);
+      chunk->row_sizes[chunk->rows_count++] = fields_count;
+    }
+
+    worker->__skip_empty_lines = SKIP_EMPTY_LINES;
+    chunk->row_end = worker->__buffer_pos;
+    return status;
+  }
+
+  /* Picks the next task: parses the first chunk whose quote state is known, or counts quotes ahead */
+  static ccsv_chunk *_next_task(struct ccsv_parallel *parallel)
+  {
+    const size_t window_end = parallel->consumed + parallel->slots_count < parallel->chunks_count
+                                  ? parallel->consumed + parallel->slots_count
+                                  : parallel->chunks_count;
+
+    for (size_t n = parallel->consumed; n < parallel->parity_known && n < window_end; n++)
+    {
+      ccsv_chunk *chunk = &parallel->slots[n % parallel->slots_count];
+      if (chunk->number == n && chunk->state == CHUNK_COUNTED)
+      {
+        chunk->state = CHUNK_PARSING;
+        return chunk;
+      }
+    }
+
+    if (parallel->next_count < window_end)
+    {
+      const size_t n = parallel->next_count++;
+      ccsv_chunk *chunk = &parallel->slots[n % parallel->slots_count];
+      const size_t chunk_size = CCSV_PARALLEL_CHUNK_SIZE;
+      const size_t file_size = parallel->proto.__buffer_size;
+      chunk->number = n;
+      chunk->start = n * chunk_size;
+      chunk->end = chunk->start + chunk_size < file_size ? chunk->start + chunk_size : file_size;
+      chunk->status = CCSV_SUCCESS;
+      chunk->state = CHUNK_COUNTING;
+      return chunk;
+    }
+
+    return NULL;
+  }
+
+  static void *_parallel_worker(void *arg)
+  {
+    struct ccsv_parallel *parallel = (struct ccsv_parallel *)arg;
+    const ccsv_reader *reader = &parallel->proto;
+
+    /* Private copy of the reader, sharing its mapping */
+    ccsv_reader worker = *reader;
+
+    pthread_mutex_lock(&parallel->lock);
+    for (;;)
+    {
+      ccsv_chunk *chunk = NULL;
+      while (!parallel->stop && (chunk = _next_task(parallel)) == NULL)
+        pthread_cond_wait(&parallel->work_ready, &parallel->lock);
+      if (parallel->stop)
+        break;
+      pthread_mutex_unlock(&parallel->lock);
+
+      if (chunk->state == CHUNK_COUNTING)
+      {
+        chunk->quotes = _count_char(reader->__buffer, chunk->start, chunk->end, reader->__quote_char);
+
+        pthread_mutex_lock(&parallel->lock);
+        chunk->state = CHUNK_COUNTED;
+
+        /* Quote state at the start of a chunk is the parity of all quotes before it */
+        while (parallel->parity_known < parallel->next_count)
+        {
+          ccsv_chunk *known = &parallel->slots[parallel->parity_known % parallel->slots_count];
+          if (known->state != CHUNK_COUNTED)
+            break;
+          known->in_quotes = parallel->in_quotes;
+          parallel->in_quotes ^= known->quotes & 1;
+          parallel->parity_known++;
+        }
+        pthread_cond_broadcast(&parallel->work_ready);
+      }
+      else
+      {
+        const int status = _parse_chunk(&worker, chunk);
+
+        pthread_mutex_lock(&parallel->lock);
+        chunk->status = status;
+        chunk->state = CHUNK_PARSED;
+        pthread_cond_broadcast(&parallel->chunk_done);
+      }
+    }
+    pthread_mutex_unlock(&parallel->lock);
+
+    free(worker.__index.positions);
+    _free_multiple(3, worker.__fields, worker.__field_starts, worker.__scratch);
+    return NULL;
+  }
+#endif
+
+  int _parallel_start(ccsv_reader *reader, int threads)
+  {
+#ifdef CCSV_THREADS
+    const size_t chunks_count = (reader->__buffer_size + CCSV_PARALLEL_CHUNK_SIZE - 1) / CCSV_PARALLEL_CHUNK_SIZE;
+    if (chunks_count < 2)
+      return CCSV_ERROR; /* Not worth the threads */
+
+    struct ccsv_parallel *parallel = (struct ccsv_parallel *)calloc(1, sizeof(struct ccsv_parallel));
+    if (parallel == NULL)
+      return CCSV_ERNOMEM;
+
+    /* A few chunks per thread are parsed ahead of the caller */
+    parallel->slots_count = (size_t)threads * 4;
+    parallel->slots = (ccsv_chunk *)calloc(parallel->slots_count, sizeof(ccsv_chunk));
+    parallel->threads = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    if (parallel->slots == NULL || parallel->threads == NULL)
+    {
+      _free_multiple(3, parallel->slots, parallel->threads, parallel);
+      return CCSV_ERNOMEM;
+    }
+
+    for (size_t i = 0; i < parallel->slots_count; i++)
+      parallel->slots[i].state = CHUNK_EMPTY;
+
+    /* Workers copy the reader settings and mapping, buffers of their own are allocated on demand */
+    parallel->proto = *reader;
+    parallel->proto.__fields = NULL;
+    parallel->proto.__field_starts = NULL;
+    parallel->proto.__fields_capacity = 0;
+    parallel->proto.__scratch = NULL;
+    parallel->proto.__scratch_capacity = 0;
+    parallel->proto.__index.positions = NULL;
+    parallel->proto.__index.backoff = 0;
+    parallel->proto.__index.fallback_fills = 0;
+    parallel->proto.__parallel = NULL;
+
+    parallel->chunks_count = chunks_count;
+    pthread_mutex_init(&parallel->lock, NULL);
+    pthread_cond_init(&parallel->work_ready, NULL);
+    pthread_cond_init(&parallel->chunk_done, NULL);
+    reader->__parallel = parallel;
+
+    for (int i = 0; i < threads; i++)
+    {
+      if (pthread_create(&parallel->threads[i], NULL, _parallel_worker, parallel) != 0)
+        break;
+      parallel->threads_count++;
+    }
+
+    if (parallel->threads_count == 0)
+    {
+      _parallel_stop(reader);
+      return CCSV_ERROR;
+    }
+
+    return CCSV_SUCCESS;
+#else
+    (void)reader;
+    (void)threads;
+    return CCSV_ERROR;
+#endif
+  }
+
+  void _parallel_stop(ccsv_reader *reader)
+  {
+#ifdef CCSV_THREADS
+    struct ccsv_parallel *parallel = reader->__parallel;
+    if (parallel == NULL)
+      return;
+
+    pthread_mutex_lock(&parallel->lock);
+    parallel->stop = true;
+    pthread_cond_broadcast(&parallel->work_ready);
+    pthread_mutex_unlock(&parallel->lock);
+
+    for (int i = 0; i < parallel->threads_count; i++)
+      pthread_join(parallel->threads[i], NULL);
+
+    for (size_t i = 0; i < parallel->slots_count; i++)
+    {
+      ccsv_chunk *chunk = &parallel->slots[i];
+      _arena_free(&chunk->arena);
+      _free_multiple(3, chunk->fields, chunk->row_sizes, chunk->row_ends);
+    }
+
+    pthread_mutex_destroy(&parallel->lock);
+    pthread_cond_destroy(&parallel->work_ready);
+    pthread_cond_destroy(&parallel->chunk_done);
+    _free_multiple(3, parallel->slots, parallel->threads, parallel);
+    reader->__parallel = NULL;
+#else
+    (void)reader;
+#endif
+  }
+
+  int _parse_row_parallel(ccsv_reader *reader)
+  {
+#ifdef CCSV_THREADS
+    struct ccsv_parallel *parallel = reader->__parallel;
+
+    for (;;)
+    {
+      if (parallel->consumed == parallel->chunks_count)
+      {
+        reader->__buffer_pos = reader->__buffer_size;
+        reader->status = CCSV_SUCCESS;
+        return 0;
+      }
+
+      ccsv_chunk *chunk = &parallel->slots[parallel->consumed % parallel->slots_count];
+
+      if (parallel->next_row == 0)
+      {
+        pthread_mutex_lock(&parallel->lock);
+        while (chunk->number != parallel->consumed || chunk->state != CHUNK_PARSED)
+          pthread_cond_wait(&parallel->chunk_done, &parallel->lock);
+        pthread_mutex_unlock(&parallel->lock);
+
+        if (chunk->status != CCSV_SUCCESS)
+        {
+          reader->status = chunk->status;
+          return chunk->status;
+        }
+
+        /* __buffer_pos is where the previous chunk ended */
+        if (chunk->irregular || chunk->row_start != reader->__buffer_pos)
+        {
+          /* Quote parity does not describe this chunk, parse the rest of the file serially */
+          const size_t pos = reader->__buffer_pos;
+          _parallel_stop(reader);
+          reader->__buffer_pos = pos;
+          reader->__index.stale = true;
+          return _parse_record(reader);
+        }
+        CCSV_STAT_ADD(reader, lines_skipped, chunk->lines_skipped);
+      }
 
-#ifdef __cplusplus
-      ccsv_writer_options *writer_options = reinterpret_cast<ccsv_writer_options *>(options);
-      ccsv_writer *writer = ccsv_init_writer(writer_options, &init_status);
-#else
-    options = (ccsv_writer_options *)options;
-    ccsv_writer *writer = ccsv_init_writer(options, &init_status);
-#endif
-      if (init_status == CCSV_ERNOMEM || writer == NULL)
+      if (parallel->next_row < chunk->rows_count)
       {
-        if (status != NULL)
-          *status = CCSV_ERNOMEM;
-        return NULL;
+        /* Kept at the end of the record handed out, so the reader can tell its position */
+        const uint64_t row_end = chunk->row_ends[parallel->next_row];
+        reader->__buffer_pos = (size_t)(row_end & ~CCSV_OFFSET_SKIP_LF);
+        reader->__skip_lf = (row_end & CCSV_OFFSET_SKIP_LF) != 0;
+
+        const int fields_count = chunk->row_sizes[parallel->next_row++];
+        reader->__row_view.fields = chunk->fields + parallel->next_field;
+        reader->__row_view.fields_count = fields_count;
+        parallel->next_field += fields_count;
+
+        reader->rows_read++;
+        reader->status = CCSV_SUCCESS;
+        return fields_count;
       }
-      writer->__fp = fp;
-      writer->object_type = object_type;
 
-      return writer;
+      /* Chunk handed out, its slot can take a chunk further ahead */
+      reader->__buffer_pos = chunk->row_end;
+      reader->__skip_lf = false; /* The next chunk starts past the LF of a CRLF */
+      parallel->next_row = 0;
+      parallel->next_field = 0;
+
+      pthread_mutex_lock(&parallel->lock);
+      chunk->state = CHUNK_EMPTY;
+      parallel->consumed++;
+      pthread_cond_broadcast(&parallel->work_ready);
+      pthread_mutex_unlock(&parallel->lock);
     }
-    return NULL;
+#else
+    (void)reader;
+    return 0;
+#endif
   }
 
-  void ccsv_close(void *obj)
+/* Field conversion */
+
+/*
+ * Eight digits are checked and converted at once on little-endian targets.
+ */
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_M_X64) || defined(_M_IX86) || \
+    defined(_M_ARM64)
+#define CCSV_SWAR_DIGITS
+#endif
+
+/*
+ * Exact products and quotients of doubles are correctly rounded only
+ * without extended precision intermediates.
+ */
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+#define CCSV_EXACT_DOUBLE_FAST_PATH
+#endif
+
+#ifdef CCSV_SWAR_DIGITS
+  static inline bool _is_eight_digits(uint64_t chunk)
   {
-    if (obj == NULL)
-      return;
+    return (chunk & 0xF0F0F0F0F0F0F0F0ULL) == 0x3030303030303030ULL &&
+           ((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) == 0x3030303030303030ULL;
+  }
 
-    if (_get_object_type(obj) == CCSV_READER)
-    {
-      ccsv_reader *reader = (ccsv_reader *)obj;
-      fclose(reader->__fp);
-      free(reader);
-    }
-    else if (_get_object_type(obj) == CCSV_WRITER)
-    {
-      ccsv_writer *writer = (ccsv_writer *)obj;
-      fclose(writer->__fp);
-      free(writer);
-    }
-    else
-    {
-      return;
-    }
+  static inline uint64_t _eight_digits_value(uint64_t chunk)
+  {
+    /* Pairs, then quads, then all eight digits are combined by multiplication */
+    chunk -= 0x3030303030303030ULL;
+    chunk = (chunk * 10) + (chunk >> 8);
+    return (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+            (((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >>
+           32;
   }
+#endif
 
-  ccsv_row *ccsv_next(ccsv_reader *reader)
+  size_t _parse_digits(const char *data, size_t pos, size_t len, uint64_t *value, int max_digits)
   {
-    if (reader == NULL)
-      return NULL;
+    const size_t end = len - pos > (size_t)max_digits ? pos + (size_t)max_digits : len;
+    uint64_t result = *value;
 
-    if (reader->__buffer == NULL)
+#ifdef CCSV_SWAR_DIGITS
+    while (end - pos >= 8)
     {
-      reader->status = CCSV_ERBUFNTALLOC;
-      return NULL;
+      uint64_t chunk;
+      memcpy(&chunk, data + pos, sizeof(chunk));
+      if (!_is_eight_digits(chunk))
+        break;
+      result = result * 100000000 + _eight_digits_value(chunk);
+      pos += 8;
     }
+#endif
 
-    if (reader->__fp == NULL)
+    while (pos < end && IS_DIGIT(data[pos]))
     {
-      reader->status = CCSV_ERNULLFP;
-      return NULL;
+      result = result * 10 + (uint64_t)(data[pos] - '0');
+      pos++;
     }
 
-    return _next(reader->__fp, reader);
+    *value = result;
+    return pos;
   }
 
-  ccsv_row *_next(FILE *fp, ccsv_reader *reader)
+  int ccsv_to_int64(const char *data, size_t len, int64_t *value)
   {
-    ccsv_row *row = (ccsv_row *)malloc(sizeof(ccsv_row));
-    if (row == NULL)
+    if (data == NULL || value == NULL)
+      return CCSV_ERINVALID;
+
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < len && (data[pos] == '-' || data[pos] == '+'))
+      negative = data[pos++] == '-';
+
+    const size_t digits_start = pos;
+    while (pos < len && data[pos] == '0')
+      pos++;
+
+    /* 19 digits always fit in 64 unsigned bits */
+    uint64_t magnitude = 0;
+    pos = _parse_digits(data, pos, len, &magnitude, 19);
+    if (pos == digits_start)
+      return CCSV_ERFORMAT;
+
+    if (pos < len)
     {
-      reader->status = CCSV_ERNOMEM;
-      return NULL;
+      if (!IS_DIGIT(data[pos]))
+        return CCSV_ERFORMAT;
+      while (pos < len && IS_DIGIT(data[pos]))
+        pos++;
+      return pos == len ? CCSV_ERRANGE : CCSV_ERFORMAT;
     }
 
-    const char DELIM = reader->__delim;
-    const char QUOTE_CHAR = reader->__quote_char;
-    const char COMMENT_CHAR = reader->__comment_char;
-    const char ESCAPE_CHAR = reader->__escape_char;
-    const int SKIP_INITIAL_SPACE = reader->__skip_initial_space;
-    const int SKIP_EMPTY_LINES = reader->__skip_empty_lines;
-    const int SKIP_COMMENTS = reader->__skip_comments;
+    if (magnitude > (uint64_t)INT64_MAX + negative)
+      return CCSV_ERRANGE;
 
-    size_t buffer_size = reader->__buffer_size;
+    if (negative)
+      *value = magnitude == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)magnitude;
+    else
+      *value = (int64_t)magnitude;
+    return CCSV_SUCCESS;
+  }
 
-    State state = FIELD_START;
+  int ccsv_to_double(const char *data, size_t len, double *value)
+  {
+    if (data == NULL || value == NULL)
+      return CCSV_ERINVALID;
 
-    char *row_string = reader->__buffer;
-    size_t row_pos = 0;
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < len && (data[pos] == '-' || data[pos] == '+'))
+      negative = data[pos++] == '-';
 
-    char **fields = (char **)malloc(sizeof(char *));
-    if (fields == NULL)
+    if (pos < len && !IS_DIGIT(data[pos]) && data[pos] != '.')
     {
-      _free_multiple(2, row_string, row);
-      reader->status = CCSV_ERNOMEM;
-      return NULL;
+      const char *word = data + pos;
+      const size_t word_len = len - pos;
+      if (_equals_ignore_case(word, word_len, "inf") || _equals_ignore_case(word, word_len, "infinity"))
+        *value = negative ? -HUGE_VAL : HUGE_VAL;
+      else if (_equals_ignore_case(word, word_len, "nan"))
+        *value = negative ? -NAN : NAN;
+      else
+        return CCSV_ERFORMAT;
+      return CCSV_SUCCESS;
     }
 
-    size_t fields_count = 0;
-
-    char *field = (char *)malloc(MAX_FIELD_SIZE + 1);
-    if (field == NULL)
+    /* The first 19 significant digits are kept, the value is mantissa * 10^exponent */
+    uint64_t mantissa = 0;
+    int64_t exponent = 0;
+    int digits = 0;
+    bool truncated = false;
+
+    const size_t int_start = pos;
+    while (pos < len && data[pos] == '0')
+      pos++;
+    size_t run_start = pos;
+    pos = _parse_digits(data, pos, len, &mantissa, 19);
+    digits = (int)(pos - run_start);
+    for (; pos < len && IS_DIGIT(data[pos]); pos++, exponent++)
+      truncated |= data[pos] != '0';
+    bool has_digits = pos > int_start;
+
+    if (pos < len && data[pos] == '.')
     {
-      _free_multiple(3, row_string, fields, row);
-      reader->status = CCSV_ERNOMEM;
-      return NULL;
+      pos++;
+      const size_t fraction_start = pos;
+      if (digits == 0)
+      {
+        /* Zeros before the first significant digit only scale the value */
+        for (; pos < len && data[pos] == '0'; pos++)
+          exponent--;
+      }
+      run_start = pos;
+      pos = _parse_digits(data, pos, len, &mantissa, 19 - digits);
+      exponent -= (int64_t)(pos - run_start);
+      for (; pos < len && IS_DIGIT(data[pos]); pos++)
+        truncated |= data[pos] != '0';
+      has_digits |= pos > fraction_start;
     }
 
-    size_t field_size = MAX_FIELD_SIZE;
-    size_t field_pos = 0;
+    if (!has_digits)
+      return CCSV_ERFORMAT;
 
-    size_t bytes_read;
-  readfile:
+    if (pos < len && (data[pos] == 'e' || data[pos] == 'E'))
+    {
+      pos++;
+      bool exponent_negative = false;
+      if (pos < len && (data[pos] == '-' || data[pos] == '+'))
+        exponent_negative = data[pos++] == '-';
+      if (pos == len || !IS_DIGIT(data[pos]))
+        return CCSV_ERFORMAT;
+
+      /* Past a few hundred the value is zero or infinite anyway */
+      int64_t exponent_value = 0;
+      for (; pos < len && IS_DIGIT(data[pos]); pos++)
+        if (exponent_value < 100000)
+          exponent_value = exponent_value * 10 + (data[pos] - '0');
+      exponent += exponent_negative ? -exponent_value : exponent_value;
+    }
+
+    if (pos != len)
+      return CCSV_ERFORMAT;
 
-    /* Checking buffer */
-    if (_is_buffer_empty(reader))
+    if (mantissa == 0)
     {
-      bytes_read = fread(reader->__buffer, sizeof(char), buffer_size, fp);
-      reader->__file_pos += bytes_read;
+      *value = negative ? -0.0 : 0.0;
+      return CCSV_SUCCESS;
+    }
 
-      if (bytes_read <= 0)
+#ifdef CCSV_EXACT_DOUBLE_FAST_PATH
+    /* Clinger's fast path: an exact mantissa and power of ten give a correctly rounded result */
+    static const double POWERS_OF_TEN[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const uint64_t MAX_EXACT = (uint64_t)1 << 53;
+    if (!truncated && mantissa <= MAX_EXACT && exponent >= -22 && exponent <= 22 + 15)
+    {
+      /* Powers of ten past 1e22 are moved into the mantissa while it stays exact */
+      while (exponent > 22 && mantissa <= MAX_EXACT / 10)
       {
-        if (fields_count > 0 || field_pos > 0)
-        {
-          /* Add the last field */
-
-          /*
-           * If fields_count > 0:
-           * This happens when the function holding the values of last row
-           * but yet to return the last row
-           *
-           * if field_pos > 0:
-           * This only happens when there is a single element in the last row and also
-           * there is no line after the current line
-           * So we need to add the only field of the last row
-           */
-          ADD_FIELD(field);
-          goto end;
-        }
+        mantissa *= 10;
+        exponent--;
+      }
 
-        _free_multiple(4, row_string, field, fields, row);
-        return NULL;
+      if (exponent <= 22)
+      {
+        double result = (double)mantissa;
+        if (exponent < 0)
+          result /= POWERS_OF_TEN[-exponent];
+        else
+          result *= POWERS_OF_TEN[exponent];
+        *value = negative ? -result : result;
+        return CCSV_SUCCESS;
       }
+    }
+#else
+    (void)truncated;
+#endif
 
-      reader->__buffer[bytes_read] = CCSV_NULL_CHAR;
-      reader->__buffer_size = bytes_read;
-      reader->__buffer_pos = 0;
-      row_pos = 0;
-      row_string = reader->__buffer;
+    return _parse_double_fallback(data, len, value);
+  }
 
-      if (IS_TERMINATOR(row_string[row_pos]) && state == FIELD_START)
-        row_pos++;
-    }
-    else
+  int _parse_double_fallback(const char *data, size_t len, double *value)
+  {
+    /* strtod() needs a NUL terminated string, fields of a mapped file are not */
+    char small[128];
+    char *copy = small;
+    if (len >= sizeof(small))
     {
-      row_string = reader->__buffer;
-      bytes_read = reader->__buffer_size;
-      row_pos = reader->__buffer_pos;
+      copy = (char *)malloc(len + 1);
+      if (copy == NULL)
+        return CCSV_ERNOMEM;
     }
+    memcpy(copy, data, len);
+    copy[len] = CCSV_NULL_CHAR;
+
+    errno = 0;
+    const double result = strtod(copy, NULL);
+    const bool overflow = errno == ERANGE && (result > DBL_MAX || result < -DBL_MAX);
+
+    if (copy != small)
+      free(copy);
+
+    if (overflow)
+      return CCSV_ERRANGE;
+    *value = result;
+    return CCSV_SUCCESS;
+  }
 
-    for (; row_pos < bytes_read;)
+  bool _equals_ignore_case(const char *data, size_t len, const char *word)
+  {
+    size_t i = 0;
+    for (; i < len && word[i] != CCSV_NULL_CHAR; i++)
     {
-      char c = row_string[row_pos++];
+      char c = data[i];
+      if (c >= 'A' && c <= 'Z')
+        c = (char)(c - 'A' + 'a');
+      if (c != word[i])
+        return false;
+    }
+    return i == len && word[i] == CCSV_NULL_CHAR;
+  }
 
-      switch (state)
+  int ccsv_to_bool(const char *data, size_t len, bool *value)
+  {
+    if (data == NULL || value == NULL)
+      return CCSV_ERINVALID;
+
+    static const char *TRUE_WORDS[] = {"true", "t", "yes", "y", "1"};
+    static const char *FALSE_WORDS[] = {"false", "f", "no", "n", "0"};
+    for (size_t i = 0; i < sizeof(TRUE_WORDS) / sizeof(TRUE_WORDS[0]); i++)
+    {
+      if (_equals_ignore_case(data, len, TRUE_WORDS[i]))
       {
-      case FIELD_START:
-        if (c == QUOTE_CHAR)
-          state = INSIDE_QUOTED_FIELD; /* Start of quoted field */
-        else if (SKIP_INITIAL_SPACE && c == CCSV_SPACE)
-          state = FIELD_NOT_STARTED; /* Skip initial spaces */
-        else if (c == DELIM || IS_TERMINATOR(c))
-        {
-          state = FIELD_END; /* Empty field or empty row */
-          row_pos--;
-        }
-        else
-        {
-          state = FIELD_STARTED;
-          field[field_pos++] = c;
-        }
-        break;
+        *value = true;
+        return CCSV_SUCCESS;
+      }
+      if (_equals_ignore_case(data, len, FALSE_WORDS[i]))
+      {
+        *value = false;
+        return CCSV_SUCCESS;
+      }
+    }
+    return CCSV_ERFORMAT;
+  }
 
-      case INSIDE_QUOTED_FIELD:
-        GROW_FIELD_BUFFER_IF_NEEDED(field, field_size, field_pos);
-        if (c == QUOTE_CHAR)
-          state = MAY_BE_ESCAPED; /* Might be the end of the field, or it might be a escaped quote */
-        else if (c == ESCAPE_CHAR)
-        {
-          field[field_pos++] = c; /* Escaped escape character */
-          row_pos++;
-        }
-        else
-          field[field_pos++] = c;
+  void _infer_value(ccsv_column_info *column, const char *data, size_t len)
+  {
+    unsigned candidates = column->__candidates;
+    int64_t int_value;
+    double double_value;
+    bool bool_value;
+    int32_t date_value;
+    int64_t timestamp_value;
+
+    /* Only types still possible are tried, a column of text stops trying after its first value */
+    if ((candidates & (1u << CCSV_TYPE_INT64)) && ccsv_to_int64(data, len, &int_value) != CCSV_SUCCESS)
+      candidates &= ~(1u << CCSV_TYPE_INT64);
+    if ((candidates & (1u << CCSV_TYPE_DOUBLE)) && ccsv_to_double(data, len, &double_value) != CCSV_SUCCESS)
+      candidates &= ~(1u << CCSV_TYPE_DOUBLE);
+    if ((candidates & (1u << CCSV_TYPE_BOOL)) && ccsv_to_bool(data, len, &bool_value) != CCSV_SUCCESS)
+      candidates &= ~(1u << CCSV_TYPE_BOOL);
+    if ((candidates & (1u << CCSV_TYPE_DATE)) && ccsv_to_date(data, len, &date_value) != CCSV_SUCCESS)
+      candidates &= ~(1u << CCSV_TYPE_DATE);
+    if ((candidates & (1u << CCSV_TYPE_TIMESTAMP)) &&
+        ccsv_to_timestamp(data, len, &timestamp_value) != CCSV_SUCCESS)
+      candidates &= ~(1u << CCSV_TYPE_TIMESTAMP);
+
+    column->__candidates = candidates;
+  }
 
-        break;
+  /* Reads count digits at data[pos], -1 if they are not all digits */
+  static int _fixed_digits(const char *data, size_t pos, size_t len, int count)
+  {
+    if (pos > len || len - pos < (size_t)count)
+      return -1;
 
-      case MAY_BE_ESCAPED:
-        if (c == QUOTE_CHAR)
-        {
-          state = INSIDE_QUOTED_FIELD; /* Escaped quote */
-          field[field_pos++] = c;
-        }
-        else if (c == DELIM || IS_TERMINATOR(c))
-        {
-          state = FIELD_END; /* End of field */
-          row_pos--;
-        }
-        else
-        {
-          state = FIELD_STARTED;
-          field[field_pos++] = c;
-        }
+    int result = 0;
+    for (int i = 0; i < count; i++)
+    {
+      if (!IS_DIGIT(data[pos + i]))
+        return -1;
+      result = result * 10 + (data[pos + i] - '0');
+    }
+    return result;
+  }
 
-        break;
+  int32_t _days_from_civil(int year, int month, int day)
+  {
+    /* Years start in March, so the leap day is the last day of a year */
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const int year_of_era = year - era * 400;
+    const int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return (int32_t)(era * 146097 + day_of_era - 719468);
+  }
 
-      case FIELD_NOT_STARTED:
-        if (c == QUOTE_CHAR)
-          state = INSIDE_QUOTED_FIELD; /* Start of quoted field */
-        else if (c == DELIM)
-        {
-          state = FIELD_END; /* Return empty field */
-          row_pos--;
-        }
-        else if (c == CCSV_SPACE)
-          state = FIELD_NOT_STARTED; /* Skip initial spaces, will only get to this point if skip_initial_spaces = 1 */
-        else
-        {
-          state = FIELD_STARTED;
-          field[field_pos++] = c; /* Start of non-quoted field */
-        }
-        break;
+  int _parse_date(const char *data, size_t len, int32_t *days)
+  {
+    const int year = _fixed_digits(data, 0, len, 4);
+    const int month = _fixed_digits(data, 5, len, 2);
+    const int day = _fixed_digits(data, 8, len, 2);
+    if (year < 0 || month < 0 || day < 0 || data[4] != '-' || data[7] != '-')
+      return CCSV_ERFORMAT;
+
+    static const int DAYS_IN_MONTH[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (month < 1 || month > 12 || day < 1 || day > DAYS_IN_MONTH[month - 1] + (month == 2 && leap))
+      return CCSV_ERRANGE;
+
+    *days = _days_from_civil(year, month, day);
+    return CCSV_SUCCESS;
+  }
 
-      case FIELD_STARTED:
-        GROW_FIELD_BUFFER_IF_NEEDED(field, field_size, field_pos);
+  int ccsv_to_date(const char *data, size_t len, int32_t *days)
+  {
+    if (data == NULL || days == NULL)
+      return CCSV_ERINVALID;
 
-        if (c == DELIM || IS_TERMINATOR(c))
-        {
-          state = FIELD_END; /* End of field */
-          row_pos--;
-        }
-        else
-          field[field_pos++] = c; /* Add the character to the field */
-        break;
+    if (len != 10)
+      return CCSV_ERFORMAT;
 
-      case FIELD_END:
-        state = FIELD_START;
+    return _parse_date(data, len, days);
+  }
 
-        if (SKIP_EMPTY_LINES &&
-            fields_count == 0 &&
-            field_pos == 0 &&
-            IS_TERMINATOR(c))
-        {
-          /* Do not return empty lines, parse again */
-          reader->__buffer_pos = row_pos;
-          goto readfile;
-        }
-        else if (SKIP_COMMENTS &&
-                 fields_count == 0 &&
-                 field_pos > 0 &&
-                 field[0] == COMMENT_CHAR)
-        {
-          /* Do not return comment lines, parse again */
-          field_pos = 0;
-          reader->__buffer_pos = row_pos + 1;
-          goto readfile;
-        }
-        else
-          ADD_FIELD(field);
+  int ccsv_to_timestamp(const char *data, size_t len, int64_t *microseconds)
+  {
+    if (data == NULL || microseconds == NULL)
+      return CCSV_ERINVALID;
 
-        field = (char *)malloc(MAX_FIELD_SIZE + 1);
-        field_size = MAX_FIELD_SIZE;
-        if (field == NULL)
-        {
-          _free_multiple(3, fields, row_string, row);
-          reader->status = CCSV_ERNOMEM;
-          return NULL;
-        }
-        field_pos = 0;
+    if (len < 10)
+      return CCSV_ERFORMAT;
 
-        if (IS_TERMINATOR(c)) /* CR or LF */
-        {
+    int32_t days;
+    const int date_status = _parse_date(data, len, &days);
+    if (date_status != CCSV_SUCCESS)
+      return date_status;
 
-          if (IS_TERMINATOR(row_string[row_pos])) /* CRLF */
-            row_pos++;
+    int64_t result = (int64_t)days * 86400 * 1000000;
+    if (len == 10)
+    {
+      *microseconds = result;
+      return CCSV_SUCCESS;
+    }
 
-          free(field);
-          goto end;
-        }
-        break;
+    if (data[10] != 'T' && data[10] != 't' && data[10] != ' ')
+      return CCSV_ERFORMAT;
 
-      default:
-        break;
-      }
-    }
+    const int hour = _fixed_digits(data, 11, len, 2);
+    const int minute = _fixed_digits(data, 14, len, 2);
+    if (hour < 0 || minute < 0 || data[13] != ':')
+      return CCSV_ERFORMAT;
+    size_t pos = 16;
 
-    // This point is reached only when for loop is completed fully
-    if (row_pos > bytes_read - 1)
+    int second = 0;
+    int64_t fraction = 0;
+    if (pos < len && data[pos] == ':')
     {
-      reader->__buffer[0] = CCSV_NULL_CHAR; /* Reset the buffer */
-      goto readfile;
+      second = _fixed_digits(data, pos + 1, len, 2);
+      if (second < 0)
+        return CCSV_ERFORMAT;
+      pos += 3;
+
+      if (pos < len && (data[pos] == '.' || data[pos] == ','))
+      {
+        pos++;
+        const size_t fraction_start = pos;
+        for (; pos < len && IS_DIGIT(data[pos]); pos++)
+          if (pos - fraction_start < 6)
+            fraction = fraction * 10 + (data[pos] - '0');
+        if (pos == fraction_start)
+          return CCSV_ERFORMAT;
+        for (size_t i = pos - fraction_start; i < 6; i++)
+          fraction *= 10;
+      }
     }
 
-  end:
-    row->fields = fields;
-    row->fields_count = fields_count;
+    if (hour > 23 || minute > 59 || second > 59)
+      return CCSV_ERRANGE;
 
-    if (row_pos > bytes_read - 1)
-      reader->__buffer[0] = CCSV_NULL_CHAR; /* Reset the buffer */
-    else
-      reader->__buffer_pos = row_pos;
+    int offset_minutes = 0;
+    if (pos < len && (data[pos] == 'Z' || data[pos] == 'z'))
+      pos++;
+    else if (pos < len && (data[pos] == '+' || data[pos] == '-'))
+    {
+      const int sign = data[pos] == '-' ? -1 : 1;
+      const int offset_hours = _fixed_digits(data, pos + 1, len, 2);
+      if (offset_hours < 0)
+        return CCSV_ERFORMAT;
+      pos += 3;
+
+      int offset_mins = 0;
+      if (pos < len)
+      {
+        /* +HH:MM or +HHMM */
+        if (data[pos] == ':')
+          pos++;
+        offset_mins = _fixed_digits(data, pos, len, 2);
+        if (offset_mins < 0)
+          return CCSV_ERFORMAT;
+        pos += 2;
+      }
+      if (offset_hours > 23 || offset_mins > 59)
+        return CCSV_ERRANGE;
+      offset_minutes = sign * (offset_hours * 60 + offset_mins);
+    }
 
-    reader->rows_read++;
-    reader->status = CCSV_SUCCESS;
-    return row;
-  }
+    if (pos != len)
+      return CCSV_ERFORMAT;
 
-  int _is_buffer_empty(ccsv_reader *reader)
-  {
-    return reader->__buffer[0] == CCSV_NULL_CHAR;
+    result += ((int64_t)hour * 3600 + minute * 60 + second - (int64_t)offset_minutes * 60) * 1000000 + fraction;
+    *microseconds = result;
+    return CCSV_SUCCESS;
   }
 
   /* Writer */
@@ -755,6 +5902,17 @@ extern "C"
     return write_row(writer->__fp, writer, row);
   }
 
+  int ccsv_write_len(ccsv_writer *writer, ccsv_row row)
+  {
+    if (writer == NULL)
+      return WRITE_ERNOTSTARTED;
+
+    if (writer->__fp == NULL)
+      return CCSV_ERNULLFP;
+
+    return write_row_len(writer->__fp, writer, row);
+  }
+
   int ccsv_write_from_array(ccsv_writer *writer, char **fields, int fields_len)
   {
     if (writer == NULL)
@@ -773,6 +5931,29 @@ extern "C"
     return (write_row_from_array(fp, writer, fields, fields_count));
   }
 
+  int write_row_len(FILE *fp, ccsv_writer *writer, ccsv_row row)
+  {
+    const int fields_count = row.fields_count;
+    char **fields = row.fields;
+    if (row.lengths == NULL)
+      return (write_row_from_array(fp, writer, fields, fields_count));
+
+    /* Rows from the reader carry their lengths, fields are not rescanned */
+    CCSV_WRITE_ROW_START(fp, writer);
+    RETURN_IF_WRITE_ERROR(writer, WRITE_STARTED);
+
+    for (int i = 0; i < fields_count; i++)
+    {
+      CCSV_WRITE_FIELD_LEN(fp, writer, fields[i], row.lengths[i]);
+      RETURN_IF_WRITE_ERROR(writer, WRITE_SUCCESS);
+    }
+    CCSV_WRITE_ROW_END(fp, writer, NULL);
+    RETURN_IF_WRITE_ERROR(writer, WRITE_ENDED);
+
+    writer->write_status = WRITE_SUCCESS;
+    return WRITE_SUCCESS;
+  }
+
   int write_row_from_array(FILE *fp, ccsv_writer *writer, char **fields, int row_len)
   {
     CCSV_WRITE_ROW_START(fp, writer);
@@ -867,6 +6048,11 @@ extern "C"
   }
 
   int _write_field(FILE *fp, ccsv_writer *writer, const char *string)
+  {
+    return _write_field_len(fp, writer, string, strlen(string));
+  }
+
+  int _write_field_len(FILE *fp, ccsv_writer *writer, const char *string, size_t string_len)
   {
     WriterState state = writer->__state;
     if (state != WRITER_ROW_START && state != WRITER_WRITING_FIELD)
@@ -882,8 +6068,6 @@ extern "C"
 
     int inside_quotes = 0;
 
-    size_t string_len = strlen(string);
-
     char ch;
     for (size_t i = 0; i < string_len; i++)
     {
@@ -910,7 +6094,7 @@ extern "C"
       fputc(QUOTE_CHAR, fp);
     }
     else
-      fputs(string, fp);
+      fwrite(string, sizeof(char), string_len, fp);
 
     writer->write_status = WRITE_SUCCESS;
     return WRITE_SUCCESS;
@@ -0,0 +1,38 @@
+#include "test.h"
+
+/* Pins how empty lines and lines holding only "" are read */
+
+#define PATH "empty_lines.csv"
+
+static void check_rows(const char *csv, int skip_empty_lines, const char *expected)
+{
+  write_file(PATH, csv, strlen(csv));
+
+  /* Both the structural index and the state machine, selected by skip_comments */
+  for (int skip_comments = 0; skip_comments < 2; skip_comments++)
+  {
+    ccsv_reader_options options = {0};
+    options.skip_empty_lines = skip_empty_lines;
+    options.skip_comments = skip_comments;
+
+    test_text actual = {0};
+    read_rows(PATH, &options, &actual);
+    CHECK(strcmp(actual.data, expected) == 0);
+    free(actual.data);
+  }
+}
+
+int main(void)
+{
+  /* An empty line is a row with one empty field */
+  check_rows("a\n\nb\n", 0, "1|1:a\n1|0:\n1|1:b\n=0\n");
+  check_rows("a\r\n\r\nb\r\n", 0, "1|1:a\n1|0:\n1|1:b\n=0\n");
+
+  /* Skipped empty lines have no bytes, a quoted empty field is a row */
+  check_rows("a\n\nb\n", 1, "1|1:a\n1|1:b\n=0\n");
+  check_rows("a\n\"\"\nb\n", 1, "1|1:a\n1|0:\n1|1:b\n=0\n");
+  check_rows("a\n\"\"\nb\n", 0, "1|1:a\n1|0:\n1|1:b\n=0\n");
+
+  remove(PATH);
+  return test_result("empty_lines");
+}
@@ -0,0 +1,83 @@
+#include "test.h"
+
+/* Compares rows of a push reader fed in small chunks with those of the file reader */
+
+#define PATH "feed.csv"
+
+/* Feeds csv in chunks of 1 byte, or of random sizes if state is set, and reads rows into text */
+static void feed_rows(const test_text *csv, ccsv_reader_options *options, uint64_t *state, test_text *text)
+{
+  text->len = 0;
+  text_append(text, "", 0);
+
+  ccsv_reader *reader = ccsv_open_push(options, NULL);
+  CHECK(reader != NULL);
+  if (reader == NULL)
+    return;
+
+  size_t pos = 0;
+  for (;;)
+  {
+    size_t len = state != NULL ? 1 + test_random(state) % 700 : 1;
+    if (len > csv->len - pos)
+      len = csv->len - pos;
+    CHECK(ccsv_feed(reader, csv->data + pos, len) == CCSV_SUCCESS);
+    pos += len;
+
+    ccsv_row *row;
+    while ((row = ccsv_next(reader)) != NULL)
+    {
+      text_append_row(text, row);
+      ccsv_free_row(row);
+    }
+    if (len == 0)
+      break;
+    CHECK(reader->status == CCSV_ERAGAIN);
+  }
+
+  char number[32];
+  text_append(text, number, (size_t)snprintf(number, sizeof(number), "=%d\n", reader->status));
+  ccsv_close(reader);
+}
+
+static void check_same_rows(const test_text *csv, ccsv_reader_options *options, uint64_t *state)
+{
+  write_file(PATH, csv->data, csv->len);
+
+  test_text expected = {0};
+  test_text actual = {0};
+  read_rows(PATH, options, &expected);
+
+  feed_rows(csv, options, NULL, &actual);
+  CHECK(expected.len == actual.len && memcmp(expected.data, actual.data, expected.len) == 0);
+
+  feed_rows(csv, options, state, &actual);
+  CHECK(expected.len == actual.len && memcmp(expected.data, actual.data, expected.len) == 0);
+
+  free(expected.data);
+  free(actual.data);
+}
+
+int main(void)
+{
+  test_text csv = {0};
+  uint64_t state = 0xd1b54a32d192ed03ull;
+
+  for (int i = 0; i < 200; i++)
+  {
+    ccsv_reader_options options = {0};
+    options.skip_empty_lines = i % 2;
+    options.validate_utf8 = i % 3 == 0;
+
+    /* A BOM, which the push reader may get one byte at a time */
+    csv.len = 0;
+    if (i % 6 == 0)
+      text_append(&csv, "\xEF\xBB\xBF", 3);
+    random_csv(&state, &csv, test_random(&state) % 6000, i % 4 == 3);
+    check_same_rows(&csv, &options, &state);
+  }
+
+  free(csv.data);
+  remove(PATH);
+  return test_result("feed");
+}
@@ -0,0 +1,42 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+
+#include "test.h"
+
+/* A pipe cannot go back, ccsv_infer_schema() must fail without consuming rows */
+int main(void)
+{
+  int fds[2];
+  if (pipe(fds) != 0)
+    return 1;
+
+  const char data[] = "x\n1\n2\n3\n";
+  if (write(fds[1], data, sizeof(data) - 1) != (ssize_t)(sizeof(data) - 1))
+    return 1;
+  close(fds[1]);
+
+  FILE *fp = fdopen(fds[0], "r");
+  ccsv_reader *reader = ccsv_open_from_file(fp, CCSV_READER, "r", NULL, NULL);
+  CHECK(reader != NULL);
+  if (reader == NULL)
+    return test_result("infer_pipe");
+
+  ccsv_schema schema = {0};
+  CHECK(ccsv_infer_schema(reader, 10, &schema) == CCSV_ERINVALID);
+  ccsv_clear_schema(&schema);
+
+  const char *expected[] = {"x", "1", "2", "3"};
+  size_t rows = 0;
+  ccsv_row *row;
+  while ((row = ccsv_next(reader)) != NULL)
+  {
+    CHECK(rows < 4 && row_is(row, expected[rows]));
+    ccsv_free_row(row);
+    rows++;
+  }
+  CHECK(rows == 4);
+
+  ccsv_close(reader);
+  return test_result("infer_pipe");
+}
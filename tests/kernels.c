@@ -0,0 +1,71 @@
+#include "test.h"
+
+/*
+ * Compares the rows of the structural index with those of the state
+ * machine, which skip_comments selects on files without comment lines.
+ * With --digest it prints a hash of all rows instead, the makefile
+ * compares it with the one of a CCSV_NO_SIMD build.
+ */
+
+#define PATH "kernels.csv"
+
+static uint64_t digest = 14695981039346656037ull;
+
+static void hash_text(const test_text *text)
+{
+  for (size_t i = 0; i < text->len; i++)
+    digest = (digest ^ (unsigned char)text->data[i]) * 1099511628211ull;
+}
+
+static void check_same_rows(const test_text *csv, int skip_empty_lines)
+{
+  write_file(PATH, csv->data, csv->len);
+
+  ccsv_reader_options index = {0};
+  index.skip_empty_lines = skip_empty_lines;
+  ccsv_reader_options state_machine = index;
+  state_machine.skip_comments = 1;
+  ccsv_reader_options mapped = index;
+  mapped.use_mmap = 1;
+
+  test_text expected = {0};
+  test_text actual = {0};
+  read_rows(PATH, &state_machine, &expected);
+  hash_text(&expected);
+
+  read_rows(PATH, &index, &actual);
+  CHECK(expected.len == actual.len && memcmp(expected.data, actual.data, expected.len) == 0);
+  hash_text(&actual);
+
+  read_rows(PATH, &mapped, &actual);
+  CHECK(expected.len == actual.len && memcmp(expected.data, actual.data, expected.len) == 0);
+  hash_text(&actual);
+
+  free(expected.data);
+  free(actual.data);
+}
+
+int main(int argc, char *argv[])
+{
+  test_text csv = {0};
+  uint64_t state = 0x2545f4914f6cdd1dull;
+
+  for (int i = 0; i < 200; i++)
+  {
+    csv.len = 0;
+    /* Larger files cross buffer refills and index windows */
+    const size_t size = i % 10 == 9 ? 150000 + test_random(&state) % 100000 : test_random(&state) % 4096;
+    random_csv(&state, &csv, size, i % 4 == 3);
+    check_same_rows(&csv, i % 2);
+  }
+
+  free(csv.data);
+  remove(PATH);
+
+  if (argc > 1 && strcmp(argv[1], "--digest") == 0)
+  {
+    printf("%016llx\n", (unsigned long long)digest);
+    return test_failures > 0;
+  }
+  return test_result("kernels");
+}
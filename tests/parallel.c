@@ -0,0 +1,81 @@
+#include "test.h"
+
+/* Built with a small CCSV_PARALLEL_CHUNK_SIZE, so records cross many chunk boundaries */
+#define CHUNK CCSV_PARALLEL_CHUNK_SIZE
+#define PATH "parallel.csv"
+
+/* Compares rows of the parallel reader with those of the serial reader */
+static void check_same_rows(const test_text *csv)
+{
+  write_file(PATH, csv->data, csv->len);
+
+  ccsv_reader_options serial = {0};
+  ccsv_reader_options parallel = {0};
+  parallel.use_mmap = 1;
+  parallel.threads = 3;
+
+  test_text expected = {0};
+  test_text actual = {0};
+  read_rows(PATH, &serial, &expected);
+  read_rows(PATH, &parallel, &actual);
+  CHECK(expected.len == actual.len && memcmp(expected.data, actual.data, expected.len) == 0);
+
+  free(expected.data);
+  free(actual.data);
+}
+
+/* Appends filler bytes up to offset */
+static void fill_to(test_text *csv, size_t offset, char c)
+{
+  while (csv->len < offset)
+    text_append(csv, &c, 1);
+}
+
+int main(void)
+{
+  test_text csv = {0};
+
+  /* CR as the last byte of a chunk, its LF starting the next one */
+  for (size_t k = 1; k <= 8; k++)
+  {
+    fill_to(&csv, k * CHUNK - 1, 'a');
+    text_append(&csv, "\r\n", 2);
+  }
+  check_same_rows(&csv);
+
+  /* Quoted LF and CRLF on chunk boundaries, and a quoted field over several chunks */
+  csv.len = 0;
+  for (size_t k = 1; k <= 8; k++)
+  {
+    text_append(&csv, "x,\"", 3);
+    fill_to(&csv, k * CHUNK - 1, 'b');
+    text_append(&csv, k % 2 ? "\n" : "\r\n", k % 2 ? 1 : 2);
+    text_append(&csv, "b\"\",c\",y\n", 9);
+  }
+  text_append(&csv, "\"", 1);
+  for (size_t i = 0; i < 4 * CHUNK; i++)
+    text_append(&csv, i % 10 == 9 ? "\n" : "d", 1);
+  text_append(&csv, "\",z\r\n", 5);
+  check_same_rows(&csv);
+
+  /* Quotes inside unquoted fields, an odd count flips the quote state of the chunks after it */
+  csv.len = 0;
+  for (size_t k = 1; k <= 8; k++)
+  {
+    fill_to(&csv, k * CHUNK - 2, 'e');
+    text_append(&csv, k % 3 ? "\"f,g\n" : "\"\"f,g\n", k % 3 ? 5 : 6);
+  }
+  check_same_rows(&csv);
+
+  uint64_t state = 0x9e3779b97f4a7c15ull;
+  for (int i = 0; i < 300; i++)
+  {
+    csv.len = 0;
+    random_csv(&state, &csv, test_random(&state) % (24 * CHUNK), i % 4 == 3);
+    check_same_rows(&csv);
+  }
+
+  free(csv.data);
+  remove(PATH);
+  return test_result("parallel");
+}
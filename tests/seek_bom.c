@@ -0,0 +1,71 @@
+#include "test.h"
+
+#define PATH "seek_bom.csv"
+#define ROWS 400000 /* More than two parallel chunks */
+
+/* Reads a mapped file with a BOM and a header, then seeks back to the start */
+static void check_seek_to_start(int threads)
+{
+  ccsv_reader_options options = {0};
+  options.use_mmap = 1;
+  options.validate_utf8 = 1;
+  options.has_header = 1;
+  options.threads = threads;
+
+  ccsv_reader *reader = ccsv_open(PATH, CCSV_READER, "r", &options, NULL);
+  CHECK(reader != NULL);
+  if (reader == NULL)
+    return;
+
+  ccsv_position start;
+  CHECK(ccsv_tell(reader, &start) == CCSV_SUCCESS);
+
+  ccsv_row *row = ccsv_next(reader);
+  CHECK(row_is(row, "0"));
+  ccsv_free_row(row);
+
+  /* The offset after the BOM is the start, the header is read again instead of returned */
+  CHECK(ccsv_seek(reader, &start) == CCSV_SUCCESS);
+  row = ccsv_next(reader);
+  CHECK(row_is(row, "0"));
+  ccsv_free_row(row);
+
+  /* ccsv_infer_schema() seeks back to where it started */
+  CHECK(ccsv_seek(reader, &start) == CCSV_SUCCESS);
+  ccsv_schema schema = {0};
+  CHECK(ccsv_infer_schema(reader, 10, &schema) == CCSV_SUCCESS);
+  ccsv_clear_schema(&schema);
+
+  char expected[16];
+  size_t rows = 0;
+  while ((row = ccsv_next(reader)) != NULL)
+  {
+    snprintf(expected, sizeof(expected), "%zu", rows);
+    CHECK(row_is(row, expected));
+    ccsv_free_row(row);
+    rows++;
+  }
+  CHECK(rows == ROWS);
+  CHECK(reader->status == CCSV_SUCCESS);
+
+  ccsv_close(reader);
+}
+
+int main(void)
+{
+  size_t capacity = 3 + 3 + (size_t)ROWS * 8;
+  char *data = (char *)malloc(capacity);
+  size_t len = 0;
+  memcpy(data, "\xEF\xBB\xBFh1\n", 6);
+  len += 6;
+  for (size_t i = 0; i < ROWS; i++)
+    len += sprintf(data + len, "%zu\n", i);
+  write_file(PATH, data, len);
+  free(data);
+
+  check_seek_to_start(1);
+  check_seek_to_start(3);
+
+  remove(PATH);
+  return test_result("seek_bom");
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/ccsv.h"
+
+static int test_failures = 0;
+
+/* Reports a failed check and goes on with the test */
+#define CHECK(cond)                                                              \
+  do                                                                             \
+  {                                                                              \
+    if (!(cond))                                                                 \
+    {                                                                            \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      test_failures++;                                                           \
+    }                                                                            \
+  } while (0)
+
+/* Writes len bytes to path */
+static inline void write_file(const char *path, const char *data, size_t len)
+{
+  FILE *fp = fopen(path, "wb");
+  if (fp == NULL || fwrite(data, 1, len, fp) != len)
+  {
+    fprintf(stderr, "cannot write %s\n", path);
+    exit(1);
+  }
+  fclose(fp);
+}
+
+/* Checks that a row holds one field equal to expected */
+static inline int row_is(const ccsv_row *row, const char *expected)
+{
+  return row != NULL && row->fields_count == 1 && strcmp(row->fields[0], expected) == 0;
+}
+
+/* Growing byte string, rows are written to it to compare two reads */
+typedef struct test_text
+{
+  char *data;
+  size_t len;
+  size_t capacity;
+} test_text;
+
+static inline void text_append(test_text *text, const char *bytes, size_t len)
+{
+  if (text->len + len + 1 > text->capacity)
+  {
+    text->capacity = (text->len + len + 1) * 2;
+    text->data = (char *)realloc(text->data, text->capacity);
+    if (text->data == NULL)
+      exit(1);
+  }
+  memcpy(text->data + text->len, bytes, len);
+  text->len += len;
+  text->data[text->len] = '\0';
+}
+
+static inline void text_append_row(test_text *text, const ccsv_row *row)
+{
+  char number[32];
+  text_append(text, number, (size_t)snprintf(number, sizeof(number), "%d|", row->fields_count));
+  for (int i = 0; i < row->fields_count; i++)
+  {
+    text_append(text, number, (size_t)snprintf(number, sizeof(number), "%zu:", row->lengths[i]));
+    text_append(text, row->fields[i], row->lengths[i]);
+  }
+  text_append(text, "\n", 1);
+}
+
+/* Reads all rows of path into text, followed by the final status of the reader */
+static inline void read_rows(const char *path, ccsv_reader_options *options, test_text *text)
+{
+  text->len = 0;
+  text_append(text, "", 0);
+
+  short status = CCSV_SUCCESS;
+  ccsv_reader *reader = ccsv_open(path, CCSV_READER, "r", options, &status);
+  if (reader == NULL)
+  {
+    fprintf(stderr, "cannot open %s: %d\n", path, status);
+    exit(1);
+  }
+
+  ccsv_row *row;
+  while ((row = ccsv_next(reader)) != NULL)
+  {
+    text_append_row(text, row);
+    ccsv_free_row(row);
+  }
+
+  char number[32];
+  text_append(text, number, (size_t)snprintf(number, sizeof(number), "=%d\n", reader->status));
+  ccsv_close(reader);
+}
+
+/* xorshift64, tests are repeatable from their seed */
+static inline uint64_t test_random(uint64_t *state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+/*
+ * Appends random records of about size bytes to text: unquoted and quoted
+ * fields, quoted newlines and quotes, LF, CRLF and CR line ends and empty
+ * lines. With irregular set, some unquoted fields also hold a quote.
+ */
+static inline void random_csv(uint64_t *state, test_text *text, size_t size, int irregular)
+{
+  static const char *ENDS[] = {"\n", "\r\n", "\r", "\n\n", "\r\n\r\n"};
+  static const char UNQUOTED[] = "ab1 ";
+  static const char QUOTED[] = "ab,\n\r\" ";
+
+  const size_t end = text->len + size;
+  while (text->len < end)
+  {
+    const int fields_count = 1 + (int)(test_random(state) % 5);
+    for (int i = 0; i < fields_count; i++)
+    {
+      if (i > 0)
+        text_append(text, ",", 1);
+
+      const size_t len = test_random(state) % 12;
+      if (test_random(state) % 3 == 0)
+      {
+        text_append(text, "\"", 1);
+        for (size_t j = 0; j < len; j++)
+        {
+          const char c = QUOTED[test_random(state) % (sizeof(QUOTED) - 1)];
+          text_append(text, &c, 1);
+          if (c == '"')
+            text_append(text, &c, 1);
+        }
+        text_append(text, "\"", 1);
+      }
+      else
+      {
+        for (size_t j = 0; j < len; j++)
+        {
+          char c = UNQUOTED[test_random(state) % (sizeof(UNQUOTED) - 1)];
+          if (irregular && j > 0 && test_random(state) % 16 == 0)
+            c = '"';
+          text_append(text, &c, 1);
+        }
+      }
+    }
+
+    const char *line_end = ENDS[test_random(state) % (sizeof(ENDS) / sizeof(ENDS[0]))];
+    text_append(text, line_end, strlen(line_end));
+  }
+}
+
+static inline int test_result(const char *name)
+{
+  if (test_failures > 0)
+  {
+    fprintf(stderr, "%s: %d checks failed\n", name, test_failures);
+    return 1;
+  }
+  printf("%s: ok\n", name);
+  return 0;
+}